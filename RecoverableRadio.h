@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_RECOVERABLE_RADIO_H_
+#define APP_RECOVERABLE_RADIO_H_
+
+#include "lorawan/LoRaRadio.h"
+
+/**
+ * When non-zero, every Nth send() wedges the radio: TX_DONE is reported as
+ * a TX timeout and received frames as RX errors until reinitialize() is
+ * called. Used to measure how fast the application recovers.
+ */
+#ifndef RADIO_FAULT_INJECTION_PERIOD
+#define RADIO_FAULT_INJECTION_PERIOD    0
+#endif
+
+/*
+ * Pass-through LoRaRadio that remembers what the stack configured at
+ * initialization, so a wedged radio can be reset and brought back
+ * without restarting the LoRaWAN stack.
+ */
+class RecoverableRadio : public LoRaRadio {
+public:
+    RecoverableRadio(LoRaRadio &radio)
+        : _radio(radio), _events(NULL), _public_network(false), _on_transmit(nullptr)
+#if RADIO_FAULT_INJECTION_PERIOD
+        , _sends(0), _wedged(false)
+#endif
+    {
+    };
+
+    /**
+     * Sets a callback run each time the stack starts a transmission,
+     * retransmissions included
+     */
+    void set_transmit_callback(mbed::Callback<void()> on_transmit)
+    {
+        _on_transmit = on_transmit;
+    };
+
+    /**
+     * Resets the radio and replays the initialization done by the stack.
+     */
+    void reinitialize()
+    {
+        if (_events == NULL) {
+            return;
+        }
+        _radio.lock();
+        _radio.radio_reset();
+        init_radio(_events);
+        _radio.set_public_network(_public_network);
+        _radio.sleep();
+        _radio.unlock();
+#if RADIO_FAULT_INJECTION_PERIOD
+        _wedged = false;
+#endif
+    };
+
+    virtual void init_radio(radio_events_t *events)
+    {
+        _events = events;
+#if RADIO_FAULT_INJECTION_PERIOD
+        _injected_events = *events;
+        _injected_events.tx_done = mbed::callback(this, &RecoverableRadio::injected_tx_done);
+        _injected_events.rx_done = mbed::callback(this, &RecoverableRadio::injected_rx_done);
+        events = &_injected_events;
+#endif
+        _radio.init_radio(events);
+    };
+    virtual void radio_reset()
+    {
+        _radio.radio_reset();
+    };
+    virtual void sleep(void)
+    {
+        _radio.sleep();
+    };
+    virtual void standby(void)
+    {
+        _radio.standby();
+    };
+    virtual void set_rx_config(radio_modems_t modem, uint32_t bandwidth,
+                               uint32_t datarate, uint8_t coderate,
+                               uint32_t bandwidth_afc, uint16_t preamble_len,
+                               uint16_t symb_timeout, bool fix_len,
+                               uint8_t payload_len, bool crc_on,
+                               bool freq_hop_on, uint8_t hop_period,
+                               bool iq_inverted, bool rx_continuous)
+    {
+        _radio.set_rx_config(modem, bandwidth, datarate, coderate, bandwidth_afc,
+                             preamble_len, symb_timeout, fix_len, payload_len,
+                             crc_on, freq_hop_on, hop_period, iq_inverted,
+                             rx_continuous);
+    };
+    virtual void set_tx_config(radio_modems_t modem, int8_t power, uint32_t fdev,
+                               uint32_t bandwidth, uint32_t datarate,
+                               uint8_t coderate, uint16_t preamble_len,
+                               bool fix_len, bool crc_on, bool freq_hop_on,
+                               uint8_t hop_period, bool iq_inverted,
+                               uint32_t timeout)
+    {
+        _radio.set_tx_config(modem, power, fdev, bandwidth, datarate, coderate,
+                             preamble_len, fix_len, crc_on, freq_hop_on,
+                             hop_period, iq_inverted, timeout);
+    };
+    virtual void send(uint8_t *buffer, uint8_t size)
+    {
+#if RADIO_FAULT_INJECTION_PERIOD
+        if (++_sends % RADIO_FAULT_INJECTION_PERIOD == 0) {
+            _wedged = true;
+        }
+#endif
+        if (_on_transmit) {
+            _on_transmit();
+        }
+        _radio.send(buffer, size);
+    };
+    virtual void receive(void)
+    {
+        _radio.receive();
+    };
+    virtual void set_channel(uint32_t freq)
+    {
+        _radio.set_channel(freq);
+    };
+    virtual uint32_t random(void)
+    {
+        return _radio.random();
+    };
+    virtual uint8_t get_status(void)
+    {
+        return _radio.get_status();
+    };
+    virtual void set_max_payload_length(radio_modems_t modem, uint8_t max)
+    {
+        _radio.set_max_payload_length(modem, max);
+    };
+    virtual void set_public_network(bool enable)
+    {
+        _public_network = enable;
+        _radio.set_public_network(enable);
+    };
+    virtual uint32_t time_on_air(radio_modems_t modem, uint8_t pkt_len)
+    {
+        return _radio.time_on_air(modem, pkt_len);
+    };
+    virtual bool perform_carrier_sense(radio_modems_t modem, uint32_t freq,
+                                       int16_t rssi_threshold,
+                                       uint32_t max_carrier_sense_time)
+    {
+        return _radio.perform_carrier_sense(modem, freq, rssi_threshold,
+                                            max_carrier_sense_time);
+    };
+    virtual void start_cad(void)
+    {
+        _radio.start_cad();
+    };
+    virtual bool check_rf_frequency(uint32_t frequency)
+    {
+        return _radio.check_rf_frequency(frequency);
+    };
+    virtual void set_tx_continuous_wave(uint32_t freq, int8_t power, uint16_t time)
+    {
+        _radio.set_tx_continuous_wave(freq, power, time);
+    };
+    virtual void lock(void)
+    {
+        _radio.lock();
+    };
+    virtual void unlock(void)
+    {
+        _radio.unlock();
+    };
+
+private:
+#if RADIO_FAULT_INJECTION_PERIOD
+    void injected_tx_done()
+    {
+        if (_wedged) {
+            _events->tx_timeout();
+        } else {
+            _events->tx_done();
+        }
+    };
+
+    void injected_rx_done(const uint8_t *payload, uint16_t size,
+                          int16_t rssi, int8_t snr)
+    {
+        if (_wedged) {
+            _events->rx_error();
+        } else {
+            _events->rx_done(payload, size, rssi, snr);
+        }
+    };
+#endif
+
+    LoRaRadio &_radio;
+    radio_events_t *_events;
+    bool _public_network;
+    mbed::Callback<void()> _on_transmit;
+#if RADIO_FAULT_INJECTION_PERIOD
+    radio_events_t _injected_events;
+    uint32_t _sends;
+    volatile bool _wedged;
+#endif
+};
+
+#endif /* APP_RECOVERABLE_RADIO_H_ */
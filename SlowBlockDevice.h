@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_SLOW_BLOCK_DEVICE_H_
+#define APP_SLOW_BLOCK_DEVICE_H_
+
+#include "mbed.h"
+#include "blockdevice/BlockDevice.h"
+
+/*
+ * Block device adding the blocking delays of internal flash to another
+ * block device, typically a HeapBlockDevice. Lets the update path be
+ * profiled on targets without spare flash for staging.
+ */
+class SlowBlockDevice : public BlockDevice {
+public:
+    /**
+     * @param bd            Block device holding the data
+     * @param erase_ms      Busy time per erase unit, in ms
+     * @param program_us    Busy time per program unit, in us
+     */
+    SlowBlockDevice(BlockDevice *bd, uint32_t erase_ms, uint32_t program_us)
+        : _bd(bd), _erase_ms(erase_ms), _program_us(program_us)
+    {
+    };
+
+    virtual int init()
+    {
+        return _bd->init();
+    };
+    virtual int deinit()
+    {
+        return _bd->deinit();
+    };
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return _bd->read(buffer, addr, size);
+    };
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        // like internal flash, the CPU is stalled for the whole operation
+        wait_us(_program_us * (size / _bd->get_program_size()));
+        return _bd->program(buffer, addr, size);
+    };
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        for (bd_size_t i = 0; i < size; i += _bd->get_erase_size(addr + i)) {
+            wait_us(_erase_ms * 1000);
+        }
+        return _bd->erase(addr, size);
+    };
+    virtual bd_size_t get_read_size() const
+    {
+        return _bd->get_read_size();
+    };
+    virtual bd_size_t get_program_size() const
+    {
+        return _bd->get_program_size();
+    };
+    virtual bd_size_t get_erase_size() const
+    {
+        return _bd->get_erase_size();
+    };
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const
+    {
+        return _bd->get_erase_size(addr);
+    };
+    virtual int get_erase_value() const
+    {
+        return _bd->get_erase_value();
+    };
+    virtual bd_size_t size() const
+    {
+        return _bd->size();
+    };
+    virtual const char *get_type() const
+    {
+        return "SLOW";
+    };
+
+private:
+    BlockDevice *_bd;
+    uint32_t _erase_ms;
+    uint32_t _program_us;
+};
+
+#endif /* APP_SLOW_BLOCK_DEVICE_H_ */
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "adaptive_sampler.h"
+
+AdaptiveSampler::AdaptiveSampler(uint32_t min_interval, uint32_t max_interval,
+                                 uint32_t threshold)
+    : _min_interval(min_interval),
+      _max_interval(max_interval < min_interval ? min_interval : max_interval),
+      _threshold(threshold)
+{
+    reset();
+}
+
+void AdaptiveSampler::reset()
+{
+    _interval = _min_interval;
+    _last_interval = _min_interval;
+    _readings = 0;
+    _calm = 0;
+}
+
+uint32_t AdaptiveSampler::update(int32_t sample)
+{
+    if (_readings < 2) {
+        _readings++;
+    } else {
+        // extrapolate the slope of the last two readings over this interval
+        int64_t slope = (int64_t) _last[0] - _last[1];
+        int64_t expected = _last[0] + slope * _interval / _last_interval;
+        int64_t error = sample - expected;
+        uint64_t deviation = error < 0 ? -error : error;
+
+        if (deviation > _threshold) {
+            _calm = 0;
+            _last_interval = _interval;
+            _interval = _min_interval;
+        } else if (deviation * 2 <= _threshold && ++_calm >= ADAPTIVE_SAMPLER_CALM_READINGS) {
+            _calm = 0;
+            _last_interval = _interval;
+            _interval = _interval * 2 > _max_interval ? _max_interval : _interval * 2;
+        } else {
+            _last_interval = _interval;
+        }
+    }
+
+    _last[1] = _last[0];
+    _last[0] = sample;
+    return _interval;
+}
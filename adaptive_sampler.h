@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_ADAPTIVE_SAMPLER_H_
+#define APP_ADAPTIVE_SAMPLER_H_
+
+#include <cstdint>
+
+/**
+ * Readings in a row within half the threshold before the
+ * interval doubles
+ */
+#define ADAPTIVE_SAMPLER_CALM_READINGS  3
+
+/*
+ * Picks the interval to the next sensor reading from how well the last
+ * readings extrapolate to the new one. When a reading strays from the
+ * linear extrapolation of the two before it by more than the threshold,
+ * the interval drops to the shortest one at once, so a fast change is not
+ * missed; once ADAPTIVE_SAMPLER_CALM_READINGS readings in a row stay
+ * within half of it, the interval doubles. It always stays
+ * within [min_interval, max_interval].
+ *
+ * The intervals only depend on the readings, so the server can replay
+ * them from the decoded readings to recover when each was taken.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+class AdaptiveSampler {
+public:
+    /**
+     * Intervals are in ms, the threshold in sensor units
+     */
+    AdaptiveSampler(uint32_t min_interval, uint32_t max_interval, uint32_t threshold);
+
+    /**
+     * Starts again from the shortest interval
+     */
+    void reset();
+
+    /**
+     * Takes a reading and returns the interval to the next one
+     */
+    uint32_t update(int32_t sample);
+
+    uint32_t interval() const
+    {
+        return _interval;
+    };
+
+private:
+    uint32_t _min_interval;
+    uint32_t _max_interval;
+    uint32_t _threshold;
+    uint32_t _interval;
+    uint32_t _last_interval;
+    int32_t _last[2];
+    uint8_t _readings;
+    uint8_t _calm;
+};
+
+#endif /* APP_ADAPTIVE_SAMPLER_H_ */
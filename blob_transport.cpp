@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blob_transport.h"
+#include "checksum.h"
+
+RamBlobSink::RamBlobSink(uint8_t *buffer, uint32_t size)
+    : _buffer(buffer),
+      _size(size)
+{
+}
+
+int RamBlobSink::begin(uint32_t size)
+{
+    return size > _size ? -1 : 0;
+}
+
+int RamBlobSink::write(uint32_t offset, const uint8_t *data, uint16_t size)
+{
+    if (offset + size > _size) {
+        return -1;
+    }
+    memcpy(_buffer + offset, data, size);
+    return 0;
+}
+
+FlashBlobSink::FlashBlobSink(UpdateStorage &storage, events::EventQueue &queue)
+    : _storage(storage),
+      _queue(queue),
+      _erase_event(0)
+{
+}
+
+int FlashBlobSink::begin(uint32_t size)
+{
+    int err = _storage.begin(size);
+    if (err == 0 && !_erase_event) {
+        _erase_event = _queue.call(mbed::callback(this, &FlashBlobSink::erase_step));
+    }
+    return err;
+}
+
+int FlashBlobSink::write(uint32_t offset, const uint8_t *data, uint16_t size)
+{
+    return _storage.program(offset, data, size);
+}
+
+void FlashBlobSink::erase_step()
+{
+    // one sector per step, leaving room for RX events in between
+    _erase_event = 0;
+    if (_storage.erase_step()) {
+        _erase_event = _queue.call_in(UPDATE_ERASE_STEP_INTERVAL,
+                                      mbed::callback(this, &FlashBlobSink::erase_step));
+    }
+}
+
+BlobTransport::BlobTransport()
+{
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        close(i);
+    }
+}
+
+int BlobTransport::open(uint8_t session, uint8_t fragments, BlobSink *sink, done_t done)
+{
+    if (session >= BLOB_MAX_SESSIONS || sink == NULL) {
+        return -1;
+    }
+
+    close(session);
+    int err = sink->begin(fragments * UPDATE_FRAGMENT_SIZE);
+    if (err) {
+        printf("\r\n Blob of %d packets does not fit session %d \r\n", fragments, session);
+        return err;
+    }
+
+    session_t &state = _sessions[session];
+    state.fragments = fragments;
+    state.sink = sink;
+    state.done = done;
+    return 0;
+}
+
+void BlobTransport::close(uint8_t session)
+{
+    session_t &state = _sessions[session];
+    memset(state.received, 0, sizeof(state.received));
+    state.fragments = 0;
+    state.received_count = 0;
+    state.bad = 0;
+    state.size = 0;
+    state.sink = NULL;
+    state.done = nullptr;
+}
+
+uint8_t BlobTransport::open_sessions() const
+{
+    uint8_t open = 0;
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        if (_sessions[i].fragments) {
+            open++;
+        }
+    }
+    return open;
+}
+
+bool BlobTransport::parse(const char *msg, uint16_t len, int &session, int &fragment,
+                          const uint8_t *&data, uint16_t &size)
+{
+    if (len < 10 || strncmp(msg, "UpdateData", 10) != 0) {
+        return false;
+    }
+
+    char *end;
+    fragment = strtol(msg + 10, &end, 10);
+    session = *end == '/' ? strtol(end + 1, &end, 10) : 0;
+    data = NULL;
+    size = 0;
+
+    const char *separator = (const char *) memchr(end, ':', len - (end - msg));
+    if (separator) {
+        data = (const uint8_t *)(separator + 1);
+        size = len - (separator + 1 - msg);
+    }
+
+    return true;
+}
+
+int BlobTransport::verify(int session, int fragment, const uint8_t *data, uint16_t size)
+{
+    if (session < 0 || session >= BLOB_MAX_SESSIONS
+            || fragment < 0 || fragment >= _sessions[session].fragments) {
+        printf("\r\n Packet %d is not part of session %d \r\n", fragment + 1, session);
+        return -1;
+    }
+
+    session_t &state = _sessions[session];
+    if (data == NULL || size < 2 || size - 2 > UPDATE_FRAGMENT_SIZE) {
+        state.bad++;
+        printf("\r\n Packet %d malformed - dropped \r\n", fragment + 1);
+        return -1;
+    }
+
+    size -= 2;
+    uint16_t crc = CRC16_CCITT_INIT;
+    if (session != 0) {
+        uint8_t id = session;
+        crc = crc16_ccitt(&id, 1, crc);
+    }
+    uint8_t number[2] = { (uint8_t)(fragment >> 8), (uint8_t) fragment };
+    crc = crc16_ccitt(number, sizeof(number), crc);
+    crc = crc16_ccitt(data, size, crc);
+
+    if (crc != ((data[size] << 8) | data[size + 1])) {
+        state.bad++;
+        printf("\r\n Packet %d CRC mismatch - dropped (%d bad) \r\n",
+               fragment + 1, state.bad);
+        return -1;
+    }
+
+    return size;
+}
+
+int BlobTransport::store(uint8_t session, int fragment, const uint8_t *data, uint16_t size)
+{
+    if (!is_open(session)) {
+        return -1;
+    }
+
+    session_t &state = _sessions[session];
+    uint32_t offset = fragment * UPDATE_FRAGMENT_SIZE;
+    int err = state.sink->write(offset, data, size);
+    if (err) {
+        return err;
+    }
+    if (offset + size > state.size) {
+        state.size = offset + size;
+    }
+
+    int last = fragment + (size + UPDATE_FRAGMENT_SIZE - 1) / UPDATE_FRAGMENT_SIZE;
+    for (; fragment < last && fragment < state.fragments; fragment++) {
+        if (!is_received(state, fragment)) {
+            state.received[fragment / 8] |= 1 << (fragment % 8);
+            state.received_count++;
+        }
+    }
+    return 0;
+}
+
+bool BlobTransport::check_complete(uint8_t session)
+{
+    if (!is_open(session) || _sessions[session].received_count != _sessions[session].fragments) {
+        return false;
+    }
+
+    uint32_t size = _sessions[session].size;
+    done_t done = _sessions[session].done;
+    close(session);
+    if (done) {
+        done(session, size);
+    }
+    return true;
+}
+
+size_t BlobTransport::missing_ranges(uint8_t session, char *buffer, size_t size) const
+{
+    const session_t &state = _sessions[session];
+    size_t len = 0;
+    buffer[0] = '\0';
+
+    for (int i = 0; i < state.fragments; i++) {
+        if (is_received(state, i)) {
+            continue;
+        }
+
+        int last = i;
+        while (last + 1 < state.fragments && !is_received(state, last + 1)) {
+            last++;
+        }
+
+        char range[10];
+        int range_len = last == i ? sprintf(range, "%s%d", len ? "," : "", i + 1)
+                        : sprintf(range, "%s%d-%d", len ? "," : "", i + 1, last + 1);
+        if (len + range_len >= size) {
+            break;
+        }
+        memcpy(buffer + len, range, range_len + 1);
+        len += range_len;
+        i = last;
+    }
+
+    return len;
+}
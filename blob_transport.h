@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_BLOB_TRANSPORT_H_
+#define APP_BLOB_TRANSPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "platform/Callback.h"
+#include "events/EventQueue.h"
+#include "update_storage.h"
+
+/**
+ * Blobs that can be received at the same time, each in its own session
+ */
+#define BLOB_MAX_SESSIONS               3
+
+/**
+ * Most fragments a blob can be split into
+ */
+#define BLOB_MAX_FRAGMENTS              255
+
+/*
+ * Destination of the data of a blob session
+ */
+class BlobSink {
+public:
+    virtual ~BlobSink() {};
+
+    /**
+     * Prepares the sink for a blob of the given size.
+     * Returns 0 on success, a negative value if the blob does not fit.
+     */
+    virtual int begin(uint32_t size) = 0;
+
+    /**
+     * Writes blob data at the given offset.
+     * Returns 0 on success, a negative value on error.
+     */
+    virtual int write(uint32_t offset, const uint8_t *data, uint16_t size) = 0;
+};
+
+/*
+ * Keeps a blob in a RAM buffer owned by the caller
+ */
+class RamBlobSink : public BlobSink {
+public:
+    RamBlobSink(uint8_t *buffer, uint32_t size);
+
+    virtual int begin(uint32_t size);
+
+    virtual int write(uint32_t offset, const uint8_t *data, uint16_t size);
+
+    const uint8_t *data() const
+    {
+        return _buffer;
+    };
+
+private:
+    uint8_t *_buffer;
+    uint32_t _size;
+};
+
+/*
+ * Writes a blob to an UpdateStorage staging area. Sectors are erased from
+ * the event queue ahead of the fragments.
+ */
+class FlashBlobSink : public BlobSink {
+public:
+    FlashBlobSink(UpdateStorage &storage, events::EventQueue &queue);
+
+    virtual int begin(uint32_t size);
+
+    virtual int write(uint32_t offset, const uint8_t *data, uint16_t size);
+
+private:
+    void erase_step();
+
+    UpdateStorage &_storage;
+    events::EventQueue &_queue;
+    int _erase_event;
+};
+
+/*
+ * Reassembles blobs sent as UpdateData<n>[/<session>]:<data><crc> downlinks
+ * of UPDATE_FRAGMENT_SIZE bytes, with the CRC-16/CCITT computed over the
+ * session id (except for session 0), the fragment number (16 bit big
+ * endian) and the data. Each open session writes to its own sink and
+ * calls its completion callback once every fragment was received.
+ */
+class BlobTransport {
+public:
+    typedef mbed::Callback<void(uint8_t session, uint32_t size)> done_t;
+
+    BlobTransport();
+
+    /**
+     * Opens a session for a blob of the given number of fragments.
+     * Returns 0 on success, a negative value if the session id is unknown
+     * or the sink cannot take the blob.
+     */
+    int open(uint8_t session, uint8_t fragments, BlobSink *sink, done_t done);
+
+    void close(uint8_t session);
+
+    bool is_open(uint8_t session) const
+    {
+        return session < BLOB_MAX_SESSIONS && _sessions[session].fragments;
+    };
+
+    uint8_t open_sessions() const;
+
+    uint8_t fragments(uint8_t session) const
+    {
+        return _sessions[session].fragments;
+    };
+
+    uint16_t received(uint8_t session) const
+    {
+        return _sessions[session].received_count;
+    };
+
+    /**
+     * Splits an UpdateData<number>[/<session>]:<data> message into its
+     * session, fragment number and data. Fragments without a session id
+     * belong to session 0. Returns false if the message is not a fragment.
+     */
+    static bool parse(const char *msg, uint16_t len, int &session, int &fragment,
+                      const uint8_t *&data, uint16_t &size);
+
+    /**
+     * Checks the fragment belongs to an open session and its CRC.
+     * Returns the size of the data without the CRC, or -1 to drop it.
+     */
+    int verify(int session, int fragment, const uint8_t *data, uint16_t size);
+
+    /**
+     * Writes the data of one or more consecutive fragments, starting at
+     * the given fragment, and marks them received
+     */
+    int store(uint8_t session, int fragment, const uint8_t *data, uint16_t size);
+
+    /**
+     * Closes the session and calls its completion callback if every
+     * fragment was received. Returns true if it did.
+     */
+    bool check_complete(uint8_t session);
+
+    /**
+     * Writes the fragments still missing as <first>-<last>,... (1-based)
+     * in at most size bytes including the terminating NUL.
+     * Returns the length written.
+     */
+    size_t missing_ranges(uint8_t session, char *buffer, size_t size) const;
+
+private:
+    typedef struct {
+        uint8_t fragments;
+        uint8_t received[(BLOB_MAX_FRAGMENTS + 7) / 8];
+        uint16_t received_count;
+        uint16_t bad;
+        uint32_t size;
+        BlobSink *sink;
+        done_t done;
+    } session_t;
+
+    bool is_received(const session_t &state, int fragment) const
+    {
+        return state.received[fragment / 8] & (1 << (fragment % 8));
+    };
+
+    session_t _sessions[BLOB_MAX_SESSIONS];
+};
+
+#endif /* APP_BLOB_TRANSPORT_H_ */
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "block_manifest.h"
+
+BlockManifest::BlockManifest(read_t read)
+    : _read(read),
+      _start(0),
+      _size(0),
+      _next_block(0),
+      _hashed(0)
+{
+}
+
+void BlockManifest::begin(uint32_t start, uint32_t size)
+{
+    _start = start;
+    _size = size;
+    _next_block = 0;
+    _hashed = 0;
+    _timer.reset();
+}
+
+void BlockManifest::cancel()
+{
+    _size = 0;
+    _next_block = 0;
+}
+
+/**
+ * Lets block_signature() read through the read callback
+ */
+static int read_trampoline(void *context, void *buffer, uint32_t addr, uint32_t size)
+{
+    return (*static_cast<BlockManifest::read_t *>(context))(buffer, addr, size);
+}
+
+int BlockManifest::next(block_signature_t &signature)
+{
+    uint32_t offset = (uint32_t) _next_block * MANIFEST_BLOCK_SIZE;
+    uint32_t size = _size - offset < MANIFEST_BLOCK_SIZE ? _size - offset : MANIFEST_BLOCK_SIZE;
+
+    _timer.start();
+    int err = block_signature(read_trampoline, &_read, _start + offset, size, signature);
+    _timer.stop();
+
+    if (err) {
+        return err;
+    }
+
+    _hashed += size;
+    _next_block++;
+    return 0;
+}
+
+uint32_t BlockManifest::ms_per_256k() const
+{
+    if (_hashed == 0) {
+        return 0;
+    }
+
+    uint64_t elapsed_us = _timer.elapsed_time().count();
+    return elapsed_us * 256 * 1024 / _hashed / 1000;
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_BLOCK_MANIFEST_H_
+#define APP_BLOCK_MANIFEST_H_
+
+#include <cstdint>
+#include "platform/Callback.h"
+#include "drivers/Timer.h"
+#include "block_signature.h"
+
+/**
+ * Address of the running image in internal flash
+ */
+#ifndef MANIFEST_IMAGE_START
+#if defined(MBED_APP_START)
+#define MANIFEST_IMAGE_START            MBED_APP_START
+#else
+#define MANIFEST_IMAGE_START            MBED_ROM_START
+#endif
+#endif
+
+/*
+ * Computes the block signatures of an image one block at a time, so the
+ * caller can send each one before the next is hashed. Data is streamed
+ * through a MANIFEST_READ_SIZE buffer and never held as a whole.
+ */
+class BlockManifest {
+public:
+    typedef mbed::Callback<int(void *buffer, uint32_t addr, uint32_t size)> read_t;
+
+    BlockManifest(read_t read);
+
+    /**
+     * Starts a manifest of size bytes of image at address start
+     */
+    void begin(uint32_t start, uint32_t size);
+
+    /**
+     * Drops the rest of the manifest
+     */
+    void cancel();
+
+    /**
+     * Hashes the next block.
+     * Returns 0 on success or the error of the read callback.
+     */
+    int next(block_signature_t &signature);
+
+    bool done() const
+    {
+        return _next_block >= block_count();
+    };
+
+    uint16_t block_count() const
+    {
+        return (_size + MANIFEST_BLOCK_SIZE - 1) / MANIFEST_BLOCK_SIZE;
+    };
+
+    uint16_t next_block() const
+    {
+        return _next_block;
+    };
+
+    /**
+     * Hashing time measured so far, scaled to 256 KB of image, in ms
+     */
+    uint32_t ms_per_256k() const;
+
+private:
+    read_t _read;
+    uint32_t _start;
+    uint32_t _size;
+    uint16_t _next_block;
+    uint32_t _hashed;
+    mbed::Timer _timer;
+};
+
+#endif /* APP_BLOCK_MANIFEST_H_ */
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "mbedtls/version.h"
+#include "mbedtls/sha256.h"
+#include "block_signature.h"
+#include "checksum.h"
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+// mbedtls 3 removed the _ret names, its plain functions return the status
+#define mbedtls_sha256_starts_ret       mbedtls_sha256_starts
+#define mbedtls_sha256_update_ret       mbedtls_sha256_update
+#define mbedtls_sha256_finish_ret       mbedtls_sha256_finish
+#endif
+
+int block_signature(block_read_t read, void *context, uint32_t addr, uint32_t size,
+                    block_signature_t &signature)
+{
+    uint8_t buffer[MANIFEST_READ_SIZE];
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    uint32_t offset = 0;
+    int err = 0;
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    signature.weak = 0;
+
+    while (offset < size) {
+        uint32_t len = size - offset < sizeof(buffer) ? size - offset : sizeof(buffer);
+        err = read(context, buffer, addr + offset, len);
+        if (err) {
+            break;
+        }
+        signature.weak = rolling_checksum(buffer, len, signature.weak);
+        mbedtls_sha256_update_ret(&sha, buffer, len);
+        offset += len;
+    }
+
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (err) {
+        return err;
+    }
+
+    memcpy(signature.strong, digest, MANIFEST_STRONG_HASH_SIZE);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_BLOCK_SIGNATURE_H_
+#define APP_BLOCK_SIGNATURE_H_
+
+#include <cstdint>
+
+/**
+ * Size of the blocks of the running image described by the manifest.
+ * Must be a multiple of UPDATE_FRAGMENT_SIZE.
+ */
+#ifndef MANIFEST_BLOCK_SIZE
+#define MANIFEST_BLOCK_SIZE             1024
+#endif
+
+/**
+ * Bytes read from flash at a time while hashing a block
+ */
+#ifndef MANIFEST_READ_SIZE
+#define MANIFEST_READ_SIZE              64
+#endif
+
+/**
+ * Bytes of SHA-256 kept as the strong hash of a block
+ */
+#define MANIFEST_STRONG_HASH_SIZE       4
+
+/**
+ * Bytes taken by a block signature in the manifest uplink
+ */
+#define MANIFEST_SIGNATURE_SIZE         (4 + MANIFEST_STRONG_HASH_SIZE)
+
+/**
+ * Signature of one block: the rsync weak checksum the server rolls over
+ * the new image to find candidate matches, and a truncated SHA-256 that
+ * confirms them.
+ */
+typedef struct {
+    uint32_t weak;
+    uint8_t strong[MANIFEST_STRONG_HASH_SIZE];
+} block_signature_t;
+
+/**
+ * Reads size bytes at addr into buffer. Returns 0 on success.
+ */
+typedef int (*block_read_t)(void *context, void *buffer, uint32_t addr, uint32_t size);
+
+/**
+ * Computes the signature of the size bytes at addr, streamed through a
+ * MANIFEST_READ_SIZE buffer.
+ * Returns 0 on success or the error of the read function.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library and mbedtls.
+ */
+int block_signature(block_read_t read, void *context, uint32_t addr, uint32_t size,
+                    block_signature_t &signature);
+
+#endif /* APP_BLOCK_SIGNATURE_H_ */
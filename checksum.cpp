@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "checksum.h"
+
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc)
+{
+    // bitwise rather than table driven: fragments are short and ROM is not
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint32_t rolling_checksum(const uint8_t *data, size_t len, uint32_t sum)
+{
+    uint16_t a = sum;
+    uint16_t b = sum >> 16;
+    while (len--) {
+        a += *data++;
+        b += a;
+    }
+    return ((uint32_t) b << 16) | a;
+}
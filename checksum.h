@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_CHECKSUM_H_
+#define APP_CHECKSUM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Initial value of a CRC-16/CCITT-FALSE computation
+ */
+#define CRC16_CCITT_INIT                0xFFFF
+
+/**
+ * Continues a CRC-16/CCITT-FALSE (polynomial 0x1021, no reflection) over
+ * len bytes. Start with CRC16_CCITT_INIT; chain calls to cover several
+ * buffers.
+ */
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc);
+
+/**
+ * Continues the rsync weak checksum over len bytes: a is the sum of the
+ * bytes and b the sum of the successive values of a, both modulo 2^16,
+ * returned as (b << 16) | a. Start with 0.
+ *
+ * The checksum of a len byte window can be rolled one byte further in
+ * constant time, which lets the server look for a block at any offset:
+ *     a' = a - out + in
+ *     b' = b - len * out + a'
+ */
+uint32_t rolling_checksum(const uint8_t *data, size_t len, uint32_t sum);
+
+#endif /* APP_CHECKSUM_H_ */
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "crypto_heap.h"
+#if CRYPTO_HEAP_SIZE
+#include "mbedtls/platform.h"
+#include "mbedtls/memory_buffer_alloc.h"
+#endif
+
+static const char *const crypto_path_names[CRYPTO_PATH_COUNT] = {
+    "join",
+    "uplink",
+    "downlink"
+};
+
+static crypto_path_t crypto_path = CRYPTO_PATH_JOIN;
+
+static uint32_t crypto_peaks[CRYPTO_PATH_COUNT];
+
+static uint32_t crypto_allocations[CRYPTO_PATH_COUNT];
+
+static uint32_t crypto_failures;
+
+#if CRYPTO_HEAP_SIZE
+static unsigned char crypto_heap_buffer[CRYPTO_HEAP_SIZE];
+
+/**
+ * Allocator functions installed by mbedtls_memory_buffer_alloc_init()
+ */
+static void *(*buffer_calloc)(size_t, size_t);
+
+static void *crypto_heap_calloc(size_t count, size_t size)
+{
+    void *block = buffer_calloc(count, size);
+    if (block == NULL) {
+        crypto_failures++;
+        return NULL;
+    }
+
+    size_t used;
+    size_t blocks;
+    mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+    uint32_t peak = used + blocks * CRYPTO_HEAP_BLOCK_OVERHEAD;
+    if (peak > crypto_peaks[crypto_path]) {
+        crypto_peaks[crypto_path] = peak;
+    }
+    crypto_allocations[crypto_path]++;
+    return block;
+}
+#endif
+
+void crypto_heap_init()
+{
+#if CRYPTO_HEAP_SIZE
+    mbedtls_memory_buffer_alloc_init(crypto_heap_buffer, sizeof(crypto_heap_buffer));
+    buffer_calloc = mbedtls_calloc;
+    mbedtls_platform_set_calloc_free(crypto_heap_calloc, mbedtls_free);
+#endif
+}
+
+void crypto_heap_set_path(crypto_path_t path)
+{
+    crypto_path = path;
+}
+
+uint32_t crypto_heap_peak(crypto_path_t path)
+{
+    return crypto_peaks[path];
+}
+
+uint32_t crypto_heap_failures()
+{
+    return crypto_failures;
+}
+
+void crypto_heap_print()
+{
+#if CRYPTO_HEAP_SIZE
+    uint32_t needed = 0;
+    printf("\r\n mbedtls heap: %lu bytes, %lu failed allocations \r\n",
+           (unsigned long) CRYPTO_HEAP_SIZE, (unsigned long) crypto_failures);
+    for (uint8_t i = 0; i < CRYPTO_PATH_COUNT; i++) {
+        printf(" %s: peak %lu bytes, %lu allocations\r\n", crypto_path_names[i],
+               (unsigned long) crypto_peaks[i], (unsigned long) crypto_allocations[i]);
+        if (crypto_peaks[i] > needed) {
+            needed = crypto_peaks[i];
+        }
+    }
+    // the free block left after the largest use takes a header too
+    printf(" Paths seen so far need %lu bytes\r\n",
+           (unsigned long)(needed + CRYPTO_HEAP_BLOCK_OVERHEAD));
+#endif
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_CRYPTO_HEAP_H_
+#define APP_CRYPTO_HEAP_H_
+
+#include <cstdint>
+
+/**
+ * Size of the static buffer mbedtls allocates from, in bytes, set with
+ * the app.mbedtls-heap-size option. 0 leaves mbedtls on the general heap.
+ */
+#ifdef MBED_CONF_APP_MBEDTLS_HEAP_SIZE
+#define CRYPTO_HEAP_SIZE                MBED_CONF_APP_MBEDTLS_HEAP_SIZE
+#else
+#define CRYPTO_HEAP_SIZE                0
+#endif
+
+/**
+ * Header the mbedtls buffer allocator puts in front of every block with
+ * MBEDTLS_MEMORY_DEBUG, on 32 bit targets
+ */
+#define CRYPTO_HEAP_BLOCK_OVERHEAD      32
+
+/**
+ * What the LoRaWAN stack is doing when mbedtls allocates, as far as the
+ * application can tell from its events: the join runs from connect() to
+ * CONNECTED and an uplink from send() to TX_DONE or a TX error. The stack
+ * checks the downlink answering an uplink before TX_DONE, so it counts as
+ * part of the uplink, and the downlink path only sees class C downlinks.
+ */
+typedef enum {
+    CRYPTO_PATH_JOIN,
+    CRYPTO_PATH_UPLINK,
+    CRYPTO_PATH_DOWNLINK,
+    CRYPTO_PATH_COUNT
+} crypto_path_t;
+
+/*
+ * Dedicated heap for mbedtls.
+ *
+ * With CRYPTO_HEAP_SIZE set, mbedtls_lora_config.h enables the mbedtls
+ * buffer allocator and crypto_heap_init() hands it a static buffer, so the
+ * cipher and CMAC contexts the LoRaWAN stack allocates for every frame no
+ * longer fragment the general heap. When the buffer runs out the frame
+ * fails with a crypto error, so it is sized from the peaks measured here:
+ * every allocation is counted against the path set by the application,
+ * with the bytes in use in the buffer right after it.
+ */
+
+/**
+ * Hands the static buffer to mbedtls. Call before the LoRaWAN stack is
+ * initialized.
+ */
+void crypto_heap_init();
+
+/**
+ * Sets the path the following allocations are counted against
+ */
+void crypto_heap_set_path(crypto_path_t path);
+
+/**
+ * Largest use of the buffer seen on a path, headers included
+ */
+uint32_t crypto_heap_peak(crypto_path_t path);
+
+/**
+ * Allocations the buffer could not serve
+ */
+uint32_t crypto_heap_failures();
+
+/**
+ * Prints the peak of every path and the size the buffer needs
+ */
+void crypto_heap_print();
+
+#endif /* APP_CRYPTO_HEAP_H_ */
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "fragment_batcher.h"
+
+FragmentBatcher::FragmentBatcher(uint8_t *buffer, uint16_t size, uint16_t fragment_size,
+                                 write_t write, void *context)
+    : _buffer(buffer),
+      _size(size),
+      _fragment_size(fragment_size),
+      _write(write),
+      _context(context),
+      _session(0),
+      _first(0),
+      _len(0),
+      _open(false),
+      _writes(0)
+{
+}
+
+void FragmentBatcher::add(uint8_t session, int fragment, const uint8_t *data, uint16_t size)
+{
+    if (_len && (!_open || session != _session || fragment != _first + _len / _fragment_size
+                 || _len + size > _size)) {
+        flush();
+    }
+
+    if (_len == 0) {
+        _session = session;
+        _first = fragment;
+    }
+    memcpy(_buffer + _len, data, size);
+    _len += size;
+    _open = size == _fragment_size;
+}
+
+void FragmentBatcher::flush()
+{
+    if (_len == 0) {
+        return;
+    }
+
+    _write(_context, _session, _first, _buffer, _len);
+    _writes++;
+    _len = 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_FRAGMENT_BATCHER_H_
+#define APP_FRAGMENT_BATCHER_H_
+
+#include <cstdint>
+
+/*
+ * Joins the data of consecutive update fragments into one buffer, so a
+ * batch of fragments is written with one call per run instead of one per
+ * fragment. A run continues with the next fragment number of the same
+ * session after a full fragment; anything else, or a full buffer, writes
+ * the run out first.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+class FragmentBatcher {
+public:
+    /**
+     * Writes size bytes of data of session, starting at fragment first
+     */
+    typedef void (*write_t)(void *context, uint8_t session, int first,
+                            const uint8_t *data, uint16_t size);
+
+    FragmentBatcher(uint8_t *buffer, uint16_t size, uint16_t fragment_size,
+                    write_t write, void *context);
+
+    /**
+     * Adds the verified data of a fragment
+     */
+    void add(uint8_t session, int fragment, const uint8_t *data, uint16_t size);
+
+    /**
+     * Writes the pending run, at the end of a batch
+     */
+    void flush();
+
+    /**
+     * Write calls made so far
+     */
+    uint32_t writes() const
+    {
+        return _writes;
+    };
+
+private:
+    uint8_t *_buffer;
+    uint16_t _size;
+    uint16_t _fragment_size;
+    write_t _write;
+    void *_context;
+    uint8_t _session;
+    int _first;
+    uint16_t _len;
+    bool _open;
+    uint32_t _writes;
+};
+
+#endif /* APP_FRAGMENT_BATCHER_H_ */
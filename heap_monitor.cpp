@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mbed.h"
+#include "heap_monitor.h"
+#if MBED_MEM_TRACING_ENABLED
+#include "platform/mbed_mem_trace.h"
+#endif
+
+/**
+ * Block sizes the free block probe does not tell apart
+ */
+#define HEAP_MONITOR_PROBE_STEP         8
+
+typedef struct {
+    uintptr_t caller;
+    uint32_t allocations;
+    uint32_t live;
+    uint32_t bytes;
+} heap_site_t;
+
+typedef struct {
+    void *ptr;
+    uint32_t size;
+    uint8_t site;
+} heap_allocation_t;
+
+static heap_stats_t heap_stats;
+
+static heap_site_t heap_sites[HEAP_MONITOR_SITES];
+
+static heap_allocation_t heap_live[HEAP_MONITOR_LIVE_SLOTS];
+
+static uint32_t heap_allocations;
+
+static uint32_t heap_untracked;
+
+/**
+ * Failed probe allocations, taken out of the failures reported by the
+ * heap statistics
+ */
+static uint32_t heap_probe_failures;
+
+static volatile bool heap_probing;
+
+/**
+ * Highest bytes in use seen outside of the probe, and whether the heap
+ * statistics peak was already raised by a probe
+ */
+static uint32_t heap_peak;
+
+static bool heap_probed;
+
+#if MBED_MEM_TRACING_ENABLED
+static uint8_t heap_site(uintptr_t caller)
+{
+    uint8_t site = 0;
+    while (site < HEAP_MONITOR_SITES - 1 && heap_sites[site].allocations
+            && heap_sites[site].caller != caller) {
+        site++;
+    }
+    if (heap_sites[site].allocations == 0 && site < HEAP_MONITOR_SITES - 1) {
+        heap_sites[site].caller = caller;
+    } else if (heap_sites[site].caller != caller) {
+        // table full: the last site counts every other caller
+        heap_sites[site].caller = 0;
+    }
+    return site;
+}
+
+static void heap_allocated(void *ptr, uint32_t size, uintptr_t caller)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    uint8_t site = heap_site(caller);
+    // probe allocations are freed before returning, they only skip the count
+    if (!heap_probing) {
+        heap_sites[site].allocations++;
+        heap_allocations++;
+#if MBED_HEAP_STATS_ENABLED
+        // the statistics lock is released before the tracing callback
+        mbed_stats_heap_t stats;
+        mbed_stats_heap_get(&stats);
+        if (stats.current_size > heap_peak) {
+            heap_peak = stats.current_size;
+        }
+#endif
+    }
+
+    for (uint8_t i = 0; i < HEAP_MONITOR_LIVE_SLOTS; i++) {
+        if (heap_live[i].ptr == NULL) {
+            heap_live[i].ptr = ptr;
+            heap_live[i].size = size;
+            heap_live[i].site = site;
+            heap_sites[site].live++;
+            heap_sites[site].bytes += size;
+            return;
+        }
+    }
+    heap_untracked++;
+}
+
+static void heap_freed(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < HEAP_MONITOR_LIVE_SLOTS; i++) {
+        if (heap_live[i].ptr == ptr) {
+            heap_site_t &site = heap_sites[heap_live[i].site];
+            site.live--;
+            site.bytes -= heap_live[i].size;
+            heap_live[i].ptr = NULL;
+            return;
+        }
+    }
+}
+
+/**
+ * Memory tracing callback, called with the tracing lock held after every
+ * heap operation
+ */
+static void heap_trace(uint8_t op, void *res, void *caller, ...)
+{
+    va_list args;
+    va_start(args, caller);
+
+    switch (op) {
+        case MBED_MEM_TRACE_MALLOC:
+            heap_allocated(res, va_arg(args, size_t), (uintptr_t) caller);
+            break;
+        case MBED_MEM_TRACE_CALLOC: {
+            size_t count = va_arg(args, size_t);
+            heap_allocated(res, count * va_arg(args, size_t), (uintptr_t) caller);
+            break;
+        }
+        case MBED_MEM_TRACE_REALLOC: {
+            void *ptr = va_arg(args, void *);
+            size_t size = va_arg(args, size_t);
+            // a failed realloc leaves the block where it was
+            if (res != NULL || size == 0) {
+                heap_freed(ptr);
+                heap_allocated(res, size, (uintptr_t) caller);
+            }
+            break;
+        }
+        case MBED_MEM_TRACE_FREE:
+            heap_freed(va_arg(args, void *));
+            break;
+        default:
+            break;
+    }
+
+    va_end(args);
+}
+#endif
+
+void heap_monitor_start()
+{
+#if MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_set_callback(heap_trace);
+#endif
+    heap_stats.lowest_largest_free = UINT32_MAX;
+}
+
+/**
+ * Largest block malloc() returns, to within HEAP_MONITOR_PROBE_STEP bytes
+ */
+static uint32_t heap_probe(uint32_t limit)
+{
+    uint32_t low = 0;
+    uint32_t high = limit + 1;
+
+    heap_probing = true;
+    while (high - low > HEAP_MONITOR_PROBE_STEP) {
+        uint32_t size = low + (high - low) / 2;
+        void *block = malloc(size);
+        if (block) {
+            free(block);
+            low = size;
+        } else {
+            heap_probe_failures++;
+            high = size;
+        }
+    }
+    heap_probing = false;
+
+    return low;
+}
+
+void heap_monitor_sample()
+{
+    uint32_t limit = HEAP_MONITOR_PROBE_MAX;
+
+#if MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t stats;
+    mbed_stats_heap_get(&stats);
+    heap_stats.used = stats.current_size;
+    heap_stats.live = stats.alloc_cnt;
+    heap_stats.failures = stats.alloc_fail_cnt - heap_probe_failures;
+    if (stats.reserved_size > stats.current_size) {
+        limit = stats.reserved_size - stats.current_size;
+    }
+
+#if MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_lock();
+#endif
+    uint32_t peak = heap_probed ? stats.current_size : stats.max_size;
+    if (peak > heap_peak) {
+        heap_peak = peak;
+    }
+    heap_stats.peak = heap_peak;
+#if MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_unlock();
+#endif
+#endif
+
+    heap_stats.largest_free = heap_probe(limit);
+    heap_probed = true;
+    if (heap_stats.largest_free < heap_stats.lowest_largest_free) {
+        heap_stats.lowest_largest_free = heap_stats.largest_free;
+    }
+
+#if MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_lock();
+    heap_stats.allocations = heap_allocations;
+    heap_stats.untracked = heap_untracked;
+    mbed_mem_trace_unlock();
+#endif
+}
+
+const heap_stats_t &heap_monitor_stats()
+{
+    return heap_stats;
+}
+
+void heap_monitor_print()
+{
+    printf("\r\n Heap: %lu bytes in use (peak %lu), %lu live, %lu allocations, %lu failed \r\n",
+           (unsigned long) heap_stats.used, (unsigned long) heap_stats.peak,
+           (unsigned long) heap_stats.live, (unsigned long) heap_stats.allocations,
+           (unsigned long) heap_stats.failures);
+    printf(" Largest free block %lu (lowest %lu)\r\n", (unsigned long) heap_stats.largest_free,
+           (unsigned long) heap_stats.lowest_largest_free);
+
+#if MBED_MEM_TRACING_ENABLED
+    if (heap_stats.untracked) {
+        printf(" %lu allocations not tracked to their site\r\n",
+               (unsigned long) heap_stats.untracked);
+    }
+    for (uint8_t i = 0; i < HEAP_MONITOR_SITES; i++) {
+        // copied under the lock, printf may allocate
+        mbed_mem_trace_lock();
+        heap_site_t site = heap_sites[i];
+        mbed_mem_trace_unlock();
+        if (site.allocations) {
+            printf(" Heap site 0x%08lx %lu allocations, %lu live, %lu bytes\r\n",
+                   (unsigned long) site.caller, (unsigned long) site.allocations,
+                   (unsigned long) site.live, (unsigned long) site.bytes);
+        }
+    }
+#endif
+}
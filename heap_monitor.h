@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_HEAP_MONITOR_H_
+#define APP_HEAP_MONITOR_H_
+
+#include <cstdint>
+
+/**
+ * When set, the heap statistics and allocation sites are printed on the
+ * serial port every HEAP_MONITOR_INTERVAL ms, for soak tests
+ */
+#ifndef HEAP_MONITOR
+#define HEAP_MONITOR                    0
+#endif
+
+/**
+ * Distinct call sites of malloc, calloc and realloc that are counted.
+ * Allocations from other sites are counted under the last one, address 0.
+ */
+#ifndef HEAP_MONITOR_SITES
+#define HEAP_MONITOR_SITES              16
+#endif
+
+/**
+ * Allocations tracked until they are freed, to count them against their
+ * call site
+ */
+#ifndef HEAP_MONITOR_LIVE_SLOTS
+#define HEAP_MONITOR_LIVE_SLOTS         64
+#endif
+
+/**
+ * Largest block the free block probe tries, when the heap size is not
+ * known from the heap statistics
+ */
+#ifndef HEAP_MONITOR_PROBE_MAX
+#define HEAP_MONITOR_PROBE_MAX          0x10000
+#endif
+
+/*
+ * Heap usage and fragmentation.
+ *
+ * Bytes in use and allocation counts come from the mbed heap statistics
+ * (platform.heap-stats-enabled). Allocations are attributed to the
+ * address that called malloc, calloc or realloc through the memory
+ * tracing callback (platform.memory-tracing-enabled): a site whose live
+ * count keeps growing leaks. Fragmentation is measured as the largest
+ * block that can still be allocated, found by trying allocations of
+ * decreasing size.
+ *
+ * The probe allocations would raise the peak of the heap statistics to
+ * nearly the whole heap, so the peak is kept here instead: updated after
+ * every allocation when memory tracing is enabled, and otherwise taken
+ * from the heap statistics until the first probe, then from the samples.
+ *
+ * The probe briefly takes most of the free heap. An allocation made by
+ * another thread meanwhile may fail, and is neither counted nor taken
+ * into the peak, so sample only when the other threads do not allocate.
+ *
+ * An allocation-stable build keeps the bytes in use, the live counts and
+ * the lowest largest free block flat once it has joined.
+ */
+
+typedef struct {
+    uint32_t used;
+    uint32_t peak;
+    uint32_t allocations;
+    uint32_t failures;
+    uint32_t largest_free;
+    uint32_t lowest_largest_free;
+    uint32_t live;
+    uint32_t untracked;
+} heap_stats_t;
+
+/**
+ * Starts counting the allocations by call site. Call first thing in
+ * main() so the allocations of the LoRaWAN stack are counted too.
+ */
+void heap_monitor_start();
+
+/**
+ * Refreshes the statistics, probing the largest free block
+ */
+void heap_monitor_sample();
+
+/**
+ * Statistics as of the last heap_monitor_sample()
+ */
+const heap_stats_t &heap_monitor_stats();
+
+/**
+ * Prints the statistics and one line per allocation site
+ */
+void heap_monitor_print();
+
+#endif /* APP_HEAP_MONITOR_H_ */
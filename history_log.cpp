@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "history_log.h"
+
+HistoryLog::HistoryLog(BlockDevice *bd, bd_size_t size)
+    : _bd(bd),
+      _size(size),
+      _start(0),
+      _initialized(false),
+      _first(0),
+      _count(0),
+      _erased_until(0)
+{
+}
+
+int HistoryLog::init()
+{
+    if (_bd == NULL) {
+        printf("\r\n No block device for the history log \r\n");
+        return -1;
+    }
+
+    int err = _bd->init();
+    if (err) {
+        printf("\r\n History block device init failed: %d \r\n", err);
+        return err;
+    }
+
+    if (_size > _bd->size()) {
+        printf("\r\n History log does not fit the block device \r\n");
+        return -1;
+    }
+
+    _start = _bd->size() - _size;
+    if (_start % _bd->get_erase_size(_start)
+            || HISTORY_POINT_SIZE % _bd->get_program_size()
+            || HISTORY_POINT_SIZE % _bd->get_read_size()) {
+        printf("\r\n History log does not match the block device geometry \r\n");
+        return -1;
+    }
+
+    // readings of an earlier boot are dropped, their times are meaningless now
+    _initialized = true;
+    clear();
+    return 0;
+}
+
+int HistoryLog::append(const history_point_t &point)
+{
+    if (!_initialized || _count >= capacity()) {
+        return -1;
+    }
+
+    bd_addr_t offset = (bd_addr_t) _count * HISTORY_POINT_SIZE;
+    while (_erased_until < offset + HISTORY_POINT_SIZE) {
+        bd_size_t sector = _bd->get_erase_size(_start + _erased_until);
+        int err = _bd->erase(_start + _erased_until, sector);
+        if (err) {
+            return err;
+        }
+        _erased_until += sector;
+    }
+
+    uint8_t record[HISTORY_POINT_SIZE];
+    memcpy(record, &point.time, 4);
+    memcpy(record + 4, &point.value, 4);
+    int err = _bd->program(record, _start + offset, HISTORY_POINT_SIZE);
+    if (err) {
+        return err;
+    }
+
+    _count++;
+    return 0;
+}
+
+void HistoryLog::drop(uint32_t n)
+{
+    _first += n < count() ? n : count();
+    if (_first == _count) {
+        clear();
+    }
+}
+
+bool HistoryLog::read(uint32_t index, history_point_t &point)
+{
+    if (!_initialized || index >= count()) {
+        return false;
+    }
+    index += _first;
+
+    uint8_t record[HISTORY_POINT_SIZE];
+    if (_bd->read(record, _start + (bd_addr_t) index * HISTORY_POINT_SIZE,
+                  HISTORY_POINT_SIZE)) {
+        return false;
+    }
+
+    memcpy(&point.time, record, 4);
+    memcpy(&point.value, record + 4, 4);
+    return true;
+}
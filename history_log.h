@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_HISTORY_LOG_H_
+#define APP_HISTORY_LOG_H_
+
+#include <cstdint>
+#include "blockdevice/BlockDevice.h"
+#include "lttb_downsampler.h"
+
+/**
+ * Bytes taken by a reading in the log
+ */
+#define HISTORY_POINT_SIZE              8
+
+/*
+ * Readings that could not be sent, appended to the end of a block device
+ * until they are backfilled. Sectors are erased as the log reaches them,
+ * so clear() costs nothing and the next appends erase again. Readings
+ * backfilled while others were appended are dropped from the front; their
+ * space is reused once the log is empty.
+ *
+ * The log does not survive a reset: init() starts it empty, because the
+ * logged times count from boot and those of an earlier boot cannot be
+ * placed. It only bridges coverage outages.
+ */
+class HistoryLog : public HistorySource {
+public:
+    /**
+     * @param bd    Block device holding the log
+     * @param size  Bytes at the end of the block device used for the log
+     */
+    HistoryLog(BlockDevice *bd, bd_size_t size);
+
+    /**
+     * Returns 0 on success, a negative value if there is no usable storage
+     */
+    int init();
+
+    /**
+     * Returns 0 on success, a negative value if the log is full or the
+     * write failed
+     */
+    int append(const history_point_t &point);
+
+    virtual bool read(uint32_t index, history_point_t &point);
+
+    void clear()
+    {
+        _first = 0;
+        _count = 0;
+        _erased_until = 0;
+    };
+
+    /**
+     * Drops the n oldest readings
+     */
+    void drop(uint32_t n);
+
+    uint32_t count() const
+    {
+        return _count - _first;
+    };
+
+    uint32_t capacity() const
+    {
+        return _size / HISTORY_POINT_SIZE;
+    };
+
+private:
+    BlockDevice *_bd;
+    bd_size_t _size;
+    bd_addr_t _start;
+    bool _initialized;
+    uint32_t _first;
+    uint32_t _count;
+    bd_size_t _erased_until;
+};
+
+#endif /* APP_HISTORY_LOG_H_ */
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include "load_generator.h"
+
+LoadGenerator::LoadGenerator(const load_profile_t &profile, uint32_t seed)
+    : _profile(profile),
+      _state(seed ? seed : 1),
+      _total_weight(0)
+{
+    for (uint8_t i = 0; i < profile.size_count; i++) {
+        _total_weight += profile.sizes[i].weight;
+    }
+}
+
+void LoadGenerator::next(load_frame_t &frame)
+{
+    const load_profile_t &profile = _profile;
+
+    frame.delay = profile.burst_interval;
+    if (random() % 1000 >= profile.burstiness) {
+        // the bursts shorten the mean gap, the other frames make up for it
+        uint32_t spread = profile.interval > profile.burst_interval
+                          ? profile.interval - profile.burst_interval : 0;
+        frame.delay += exponential((uint64_t) spread * 1000 / (1000 - profile.burstiness));
+    }
+
+    frame.confirmed = random() % 1000 < profile.confirmed;
+
+    frame.size = 0;
+    if (_total_weight) {
+        uint32_t pick = random() % _total_weight;
+        for (uint8_t i = 0; i < profile.size_count; i++) {
+            if (pick < profile.sizes[i].weight) {
+                frame.size = profile.sizes[i].size;
+                break;
+            }
+            pick -= profile.sizes[i].weight;
+        }
+    }
+}
+
+uint32_t LoadGenerator::random()
+{
+    // xorshift32
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+}
+
+uint32_t LoadGenerator::exponential(uint32_t mean)
+{
+    // uniform in (0, 1], so the logarithm stays finite
+    double uniform = ((random() >> 8) + 1) / 16777216.0;
+    double delay = -log(uniform) * mean;
+    return delay < UINT32_MAX ? (uint32_t) delay : UINT32_MAX;
+}
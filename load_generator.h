@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_LOAD_GENERATOR_H_
+#define APP_LOAD_GENERATOR_H_
+
+#include <cstdint>
+
+/**
+ * When set, the device sends synthetic traffic drawn from the profile
+ * below instead of its application messages, to load a network server
+ */
+#ifndef LOAD_GENERATOR
+#define LOAD_GENERATOR                  0
+#endif
+
+/**
+ * Mean interval between frames, in ms
+ */
+#ifndef LOAD_INTERVAL
+#define LOAD_INTERVAL                   10000
+#endif
+
+/**
+ * Interval between the frames of a burst, in ms, and the shortest one
+ * between any two frames. A class A device cannot send again before its
+ * receive windows close, about 3 s after the uplink.
+ */
+#ifndef LOAD_BURST_INTERVAL
+#define LOAD_BURST_INTERVAL             3000
+#endif
+
+/**
+ * Frames sent LOAD_BURST_INTERVAL after the previous one, in 1/1000.
+ * 0 spreads the frames as a Poisson process; higher values group them in
+ * bursts, the mean rate staying at one frame per LOAD_INTERVAL.
+ */
+#ifndef LOAD_BURSTINESS
+#define LOAD_BURSTINESS                 0
+#endif
+
+/**
+ * Frames sent confirmed, in 1/1000
+ */
+#ifndef LOAD_CONFIRMED
+#define LOAD_CONFIRMED                  100
+#endif
+
+/**
+ * Distribution of the application payload sizes, as { bytes, weight }
+ * pairs
+ */
+#ifndef LOAD_PAYLOAD_SIZES
+#define LOAD_PAYLOAD_SIZES              { 4, 50 }, { 12, 35 }, { 30, 15 }
+#endif
+
+typedef struct {
+    uint8_t size;
+    uint16_t weight;
+} load_size_t;
+
+typedef struct {
+    uint32_t interval;
+    uint32_t burst_interval;
+    uint16_t burstiness;
+    uint16_t confirmed;
+    const load_size_t *sizes;
+    uint8_t size_count;
+} load_profile_t;
+
+typedef struct {
+    uint32_t delay;
+    uint8_t size;
+    bool confirmed;
+} load_frame_t;
+
+/*
+ * Draws synthetic uplinks from a traffic profile: when each frame goes
+ * out, how large it is and whether it is confirmed. The gaps are
+ * LOAD_BURST_INTERVAL plus an exponential wait, except for the share of
+ * frames following the previous one in a burst, so the mean rate does not
+ * depend on the burstiness.
+ *
+ * The draws only depend on the seed, so a host tool can replay the
+ * traffic of many devices from their seeds. Shared with the host tools,
+ * so it only depends on the C++ standard library.
+ */
+class LoadGenerator {
+public:
+    /**
+     * The profile and its size table must stay valid
+     */
+    LoadGenerator(const load_profile_t &profile, uint32_t seed);
+
+    /**
+     * Draws the next frame, with its delay after the previous one in ms
+     */
+    void next(load_frame_t &frame);
+
+private:
+    uint32_t random();
+
+    uint32_t exponential(uint32_t mean);
+
+    const load_profile_t &_profile;
+    uint32_t _state;
+    uint32_t _total_weight;
+};
+
+#endif /* APP_LOAD_GENERATOR_H_ */
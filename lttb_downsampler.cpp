@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include "lttb_downsampler.h"
+
+LttbDownsampler::LttbDownsampler()
+    : _source(NULL),
+      _count(0),
+      _target(0),
+      _selected(0)
+{
+    _previous.time = 0;
+    _previous.value = 0;
+}
+
+void LttbDownsampler::begin(HistorySource *source, uint32_t count, uint32_t target)
+{
+    _source = source;
+    _count = count;
+    _target = target < 3 ? 3 : target;
+    _selected = 0;
+}
+
+uint32_t LttbDownsampler::bucket_start(uint32_t bucket) const
+{
+    // buckets of (count - 2) / (target - 2) readings between the first and the last
+    return 1 + (uint64_t) bucket * (_count - 2) / (_target - 2);
+}
+
+bool LttbDownsampler::next(history_point_t &point)
+{
+    if (_source == NULL) {
+        return false;
+    }
+
+    uint32_t output = _count <= _target ? _count : _target;
+    if (_selected >= output) {
+        return false;
+    }
+
+    if (_count <= _target || _selected == 0 || _selected == output - 1) {
+        // the first and last readings are always kept
+        uint32_t index = _count <= _target ? _selected : (_selected == 0 ? 0 : _count - 1);
+        if (!_source->read(index, point)) {
+            return false;
+        }
+        _previous = point;
+        _selected++;
+        return true;
+    }
+
+    uint32_t bucket = _selected - 1;
+    uint32_t first = bucket_start(bucket);
+    uint32_t end = bucket_start(bucket + 1);
+    uint32_t next_end = bucket + 2 < _target - 2 ? bucket_start(bucket + 2) : _count;
+
+    // average of the next bucket, the last reading for the last bucket
+    double next_time = 0;
+    double next_value = 0;
+    history_point_t candidate;
+    for (uint32_t i = end; i < next_end; i++) {
+        if (!_source->read(i, candidate)) {
+            return false;
+        }
+        next_time += candidate.time;
+        next_value += candidate.value;
+    }
+    next_time /= next_end - end;
+    next_value /= next_end - end;
+
+    // times relative to the previous reading keep the products in range
+    double largest = -1;
+    for (uint32_t i = first; i < end; i++) {
+        if (!_source->read(i, candidate)) {
+            return false;
+        }
+        double dt = (double) candidate.time - _previous.time;
+        double dv = (double) candidate.value - _previous.value;
+        double area = (next_time - _previous.time) * dv - dt * (next_value - _previous.value);
+        area = area < 0 ? -area : area;
+        if (area > largest) {
+            largest = area;
+            point = candidate;
+        }
+    }
+
+    _previous = point;
+    _selected++;
+    return true;
+}
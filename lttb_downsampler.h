@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_LTTB_DOWNSAMPLER_H_
+#define APP_LTTB_DOWNSAMPLER_H_
+
+#include <cstdint>
+
+/**
+ * A timestamped sensor reading
+ */
+typedef struct {
+    uint32_t time;
+    int32_t value;
+} history_point_t;
+
+/*
+ * Readings stored outside RAM, read back one at a time by index
+ */
+class HistorySource {
+public:
+    virtual ~HistorySource() {};
+
+    /**
+     * Returns false if the reading cannot be read
+     */
+    virtual bool read(uint32_t index, history_point_t &point) = 0;
+};
+
+/*
+ * Largest-Triangle-Three-Buckets downsampling.
+ *
+ * Reduces count readings to target ones while keeping the shape of the
+ * series: the first and last readings are kept, the others are split in
+ * target - 2 buckets and each bucket keeps the reading forming the
+ * largest triangle with the one kept from the previous bucket and the
+ * average of the next bucket. Peaks and troughs thus survive where plain
+ * decimation or averaging would flatten them.
+ *
+ * Readings are pulled from the source as they are needed, each one twice,
+ * and next() selects one output reading per call, so any number of stored
+ * readings is reduced in constant RAM and in steps short enough to run
+ * between other events.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+class LttbDownsampler {
+public:
+    LttbDownsampler();
+
+    /**
+     * Starts reducing readings [0, count) of the source to target readings,
+     * at least 3. Fewer than target readings are all kept.
+     */
+    void begin(HistorySource *source, uint32_t count, uint32_t target);
+
+    /**
+     * Selects the next output reading. Returns false once all are out,
+     * or if the source fails.
+     */
+    bool next(history_point_t &point);
+
+    uint32_t selected() const
+    {
+        return _selected;
+    };
+
+private:
+    uint32_t bucket_start(uint32_t bucket) const;
+
+    HistorySource *_source;
+    uint32_t _count;
+    uint32_t _target;
+    uint32_t _selected;
+    history_point_t _previous;
+};
+
+#endif /* APP_LTTB_DOWNSAMPLER_H_ */
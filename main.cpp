@@ -28,6 +28,30 @@
 #include "DummySensor.h"
 #include "trace_helper.h"
 #include "lora_radio_helper.h"
+#include "RecoverableRadio.h"
+#include "radio_health.h"
+#include "update_storage.h"
+#if UPDATE_STORAGE_SIMULATE_SLOW_FLASH
+#include "blockdevice/HeapBlockDevice.h"
+#include "SlowBlockDevice.h"
+#endif
+#include "update_planner.h"
+#include "checksum.h"
+#include "block_manifest.h"
+#include "blob_transport.h"
+#include "fragment_batcher.h"
+#include "uplink_fragmenter.h"
+#include "uplink_retention.h"
+#include "sample_codec.h"
+#include "adaptive_sampler.h"
+#include "history_log.h"
+#include "lttb_downsampler.h"
+#include "timestamp_codec.h"
+#include "metrics.h"
+#include "sampling_profiler.h"
+#include "heap_monitor.h"
+#include "crypto_heap.h"
+#include "load_generator.h"
 
 using namespace events;
 
@@ -35,30 +59,221 @@ using namespace events;
 // This example only communicates with much shorter messages (<30 bytes).
 // If longer messages are used, these buffers must be changed accordingly.
 uint8_t tx_buffer[30];
-uint8_t rx_buffer[LORAMAC_PHY_MAXPAYLOAD];
+
+/**
+ * Number of downlinks that can wait for the application to handle them.
+ * In class C downlinks can arrive faster than they are printed and parsed.
+ */
+#define RX_RING_SLOTS                   4
+
+/**
+ * When set, synthetic UpdateData fragments are fed into the RX ring every
+ * RX_RING_STRESS_INTERVAL ms, about the air time of a fragment at the
+ * fastest RX2 data rate (SF7/250 kHz), to check the ring keeps up.
+ */
+#ifndef RX_RING_STRESS_TEST
+#define RX_RING_STRESS_TEST             0
+#endif
+#define RX_RING_STRESS_INTERVAL         60
+
+/**
+ * Fragments waiting to be written at which the server is asked to slow
+ * down, and the number of fragments handled without backlog before it is
+ * asked to speed up again.
+ */
+#define FLOW_CONTROL_HIGH_WATER         (RX_RING_SLOTS - 1)
+#define FLOW_CONTROL_CALM_FRAGMENTS     16
+
+/**
+ * Bounds of the fragment interval requested from the server, in ms
+ */
+#define FRAGMENT_INTERVAL_MIN           250
+#define FRAGMENT_INTERVAL_MAX           16000
+
+/**
+ * Fragment intervals, or fast poll uplinks, without an update packet
+ * after which the fragments still missing are reported, in case the last
+ * ones of a round were lost
+ */
+#define UPDATE_RECEPTION_TIMEOUT        4
+
+/**
+ * Missing reports in a row without an update packet before the update is
+ * given up and the device goes back to class A
+ */
+#define UPDATE_SILENT_ROUNDS            3
+
+/**
+ * Fast poll uplinks in a row without an update packet before the update
+ * is given up
+ */
+#define UPDATE_FAST_POLL_IDLE_LIMIT     ((UPDATE_SILENT_ROUNDS + 1) * UPDATE_RECEPTION_TIMEOUT)
+
+/**
+ * Session 0 of the blob transport receives the firmware image, staged in
+ * update_storage. The others carry small data blobs (calibration tables,
+ * channel plans) kept in RAM, sharing the same class C window.
+ */
+#define UPDATE_FIRMWARE_SESSION         0
+
+/**
+ * Largest data blob a session other than the firmware one can receive
+ */
+#define UPDATE_DATA_SESSION_SIZE        512
+
+/**
+ * A downlink as received from the stack
+ */
+typedef struct {
+    uint8_t data[LORAMAC_PHY_MAXPAYLOAD + 1];
+    int16_t len;
+    uint8_t port;
+    int flags;
+    lorawan_rx_metadata metadata;
+} rx_slot_t;
+
+static rx_slot_t rx_ring[RX_RING_SLOTS];
 
 /*
  * Sets up an application dependent transmission timer in ms. Used only when Duty Cycling is off for testing
  */
 #define TX_TIMER                        10000
 
+/**
+ * Application events that can be pending at the same time, one each:
+ * sensor conversion or reading, DeviceTime requests, stalled event
+ * restart, telemetry retry, queued uplink retry, required uplink, RX ring
+ * processing, staging erase step, update reception timeout, uplink
+ * fragment, history backfill step and rejoin; plus the load generator,
+ * RX ring stress test, profiler dump and heap report when built in.
+ */
+#define APP_EVENT_COUNT                 (12 + LOAD_GENERATOR + RX_RING_STRESS_TEST \
+                                         + SAMPLING_PROFILER + HEAP_MONITOR)
+
 /**
  * Maximum number of events for the event queue.
- * 10 is the safe number for the stack events, however, if application
- * also uses the queue for whatever purposes, this number should be increased.
+ * 10 is the safe number for the stack events, plus the application's.
+ */
+#define MAX_NUMBER_OF_EVENTS            (10 + APP_EVENT_COUNT)
+
+/**
+ * Period of the check restarting the sensor and telemetry events that
+ * could not be scheduled, in ms
  */
-#define MAX_NUMBER_OF_EVENTS            10
+#define EVENT_RESTART_INTERVAL          60000
 
 /**
  * Maximum number of retries for CONFIRMED messages before giving up
  */
 #define CONFIRMED_MSG_RETRY_COUNTER     3
 
+/**
+ * Maximum number of application messages waiting for the duty cycle
+ */
+#define UPLINK_QUEUE_SIZE               4
+
+/**
+ * Port of the frames of fragmented uplinks, kept apart from the
+ * application messages on MBED_CONF_LORA_APP_PORT
+ */
+#define UPLINK_FRAGMENT_PORT            16
+
+/**
+ * Port of the sequence numbered telemetry records, acknowledged by the
+ * server with Ack<base>,<bitmap> instead of confirmed uplinks
+ */
+#define TELEMETRY_PORT                  17
+
+/**
+ * Port of the synthetic frames sent when LOAD_GENERATOR is set
+ */
+#define LOAD_GENERATOR_PORT             18
+
+/**
+ * Uplink frame loss assumed until the server reports it with
+ * UplinkLoss<permille>, in 1/1000. Sets how many parity frames
+ * fragmented uplinks carry.
+ */
+#define UPLINK_FEC_DEFAULT_LOSS         20
+
+/**
+ * Bounds of the backoff before resending an uplink that failed, in ms.
+ * The backoff doubles on every failure and resets on TX_DONE.
+ */
+#define TX_ERROR_BACKOFF_MIN            1000
+#define TX_ERROR_BACKOFF_MAX            64000
+
 /**
  * Dummy pin for dummy sensor
  */
 #define PC_9                            0
 
+/**
+ * Bounds of the interval between temperature readings, in ms. It shrinks
+ * while the temperature changes quickly and grows while it is steady.
+ */
+#ifndef SENSOR_SAMPLE_INTERVAL_MIN
+#define SENSOR_SAMPLE_INTERVAL_MIN      10000
+#endif
+#ifndef SENSOR_SAMPLE_INTERVAL_MAX
+#define SENSOR_SAMPLE_INTERVAL_MAX      300000
+#endif
+
+/**
+ * Deviation from the trend of the last readings that brings the interval
+ * back to SENSOR_SAMPLE_INTERVAL_MIN, in 1/16 degree
+ */
+#ifndef SENSOR_SAMPLE_THRESHOLD
+#define SENSOR_SAMPLE_THRESHOLD         2
+#endif
+
+/**
+ * Bytes at the end of the default block device keeping the readings that
+ * could not be sent during a coverage outage
+ */
+#ifndef HISTORY_LOG_SIZE
+#define HISTORY_LOG_SIZE                8192
+#endif
+
+/**
+ * Largest number of logged readings backfilled once coverage returns,
+ * and the air time the backfill may take, in ms. The log is reduced to
+ * whichever is smaller, keeping its shape.
+ */
+#ifndef HISTORY_BACKFILL_POINTS
+#define HISTORY_BACKFILL_POINTS         64
+#endif
+#ifndef HISTORY_BACKFILL_AIRTIME
+#define HISTORY_BACKFILL_AIRTIME        20000
+#endif
+
+/**
+ * Period of the DeviceTime requests correcting the timestamps of the
+ * backfilled readings, in ms
+ */
+#ifndef DEVICE_TIME_SYNC_INTERVAL
+#define DEVICE_TIME_SYNC_INTERVAL       (24 * 3600 * 1000)
+#endif
+
+/**
+ * Period of the sampling profiler dumps, in ms
+ */
+#ifndef PROFILER_DUMP_INTERVAL
+#define PROFILER_DUMP_INTERVAL          60000
+#endif
+
+/**
+ * Period of the heap reports printed when HEAP_MONITOR is set, in ms
+ */
+#ifndef HEAP_MONITOR_INTERVAL
+#define HEAP_MONITOR_INTERVAL           600000
+#endif
+
+/**
+ * Time a DS1820 takes to convert a reading at 12 bit resolution, in ms
+ */
+#define DS1820_CONVERSION_TIME          750
+
 #define ON                              1
 #define OFF                             0
 
@@ -72,308 +287,2259 @@ DS1820  ds1820(PC_9);
 DigitalOut green_led(LED2);
 DigitalOut blue_led(LED3);
 
-/**
-* This event queue is the global event queue for both the
-* application and stack. To conserve memory, the stack is designed to run
-* in the same thread as the application and the application is responsible for
-* providing an event queue to the stack that will be used for ISR deferment as
-* well as application information event queuing.
-*/
-static EventQueue ev_queue(MAX_NUMBER_OF_EVENTS *EVENTS_EVENT_SIZE);
+/**
+* This event queue is the global event queue for both the
+* application and stack. To conserve memory, the stack is designed to run
+* in the same thread as the application and the application is responsible for
+* providing an event queue to the stack that will be used for ISR deferment as
+* well as application information event queuing.
+*/
+static EventQueue ev_queue(MAX_NUMBER_OF_EVENTS *EVENTS_EVENT_SIZE);
+
+/**
+ * Event handler.
+ *
+ * This will be passed to the LoRaWAN stack to queue events for the
+ * application which in turn drive the application.
+ */
+static void lora_event_handler(lorawan_event_t event);
+
+/**
+ * Wrapper around the radio object from lora_radio_helper so it can be
+ * reinitialized when it stops responding.
+ */
+static RecoverableRadio recoverable_radio(radio);
+
+/**
+ * Constructing Mbed LoRaWANInterface and passing it the radio object from lora_radio_helper.
+ */
+static LoRaWANInterface lorawan(recoverable_radio);
+
+/**
+ * Watches radio error streaks and TX_DONE latency, reinitializing the radio
+ * when it stops responding.
+ */
+static RadioHealthMonitor radio_health(recoverable_radio);
+
+/**
+ * Staging area for received updates
+ */
+#if UPDATE_STORAGE_SIMULATE_SLOW_FLASH
+static HeapBlockDevice staging_heap_bd(UPDATE_SIMULATED_FLASH_SIZE, 1,
+                                       UPDATE_SIMULATED_PROGRAM_SIZE,
+                                       UPDATE_SIMULATED_SECTOR_SIZE);
+static SlowBlockDevice staging_bd(&staging_heap_bd, UPDATE_SIMULATED_ERASE_TIME,
+                                  UPDATE_SIMULATED_PROGRAM_TIME);
+static UpdateStorage update_storage(&staging_bd);
+static HeapBlockDevice history_heap_bd(HISTORY_LOG_SIZE, 1, UPDATE_SIMULATED_PROGRAM_SIZE,
+                                       UPDATE_SIMULATED_SECTOR_SIZE);
+static SlowBlockDevice history_bd(&history_heap_bd, UPDATE_SIMULATED_ERASE_TIME,
+                                  UPDATE_SIMULATED_PROGRAM_TIME);
+static HistoryLog history_log(&history_bd, HISTORY_LOG_SIZE);
+#else
+static UpdateStorage update_storage(BlockDevice::get_default_instance(), HISTORY_LOG_SIZE);
+static HistoryLog history_log(BlockDevice::get_default_instance(), HISTORY_LOG_SIZE);
+#endif
+
+/**
+ * Reassembles the update sessions received as UpdateData fragments
+ */
+static BlobTransport blob_transport;
+
+static FlashBlobSink firmware_sink(update_storage, ev_queue);
+
+static uint8_t session_data[BLOB_MAX_SESSIONS - 1][UPDATE_DATA_SESSION_SIZE];
+
+static RamBlobSink data_sinks[BLOB_MAX_SESSIONS - 1] = {
+    RamBlobSink(session_data[0], UPDATE_DATA_SESSION_SIZE),
+    RamBlobSink(session_data[1], UPDATE_DATA_SESSION_SIZE),
+};
+
+/**
+ * Internal flash holding the running image
+ */
+static FlashIAP image_flash;
+
+/**
+ * Block signatures of the running image, sent on StartUpdate<n>,Delta so
+ * the server only sends the blocks that changed
+ */
+static BlockManifest block_manifest(mbed::callback(&image_flash, &FlashIAP::read));
+
+/**
+ * Application specific callbacks
+ */
+static lorawan_app_callbacks_t callbacks;
+
+static uint8_t is_class_c = 0;
+
+static void switch_to_class_c();
+
+static void switch_to_class_a();
+
+static void check_if_update(char* received_msg);
+
+static void update_firmware_counter(char* received_msg, uint16_t len);
+
+static void send_specific_message(string message);
+
+static bool queue_uplink(const char *message, size_t replace_len);
+
+static bool queue_uplink(const uint8_t *data, uint8_t len, size_t replace_len);
+
+static int begin_update(uint8_t session, uint8_t packets);
+
+static void queue_manifest();
+
+static uint32_t running_image_size();
+
+static void keep_unchanged_blocks(const char *received_msg);
+
+/**
+ * Set while an update is pulled with empty class A uplinks instead of class C
+ */
+static uint8_t is_fast_poll = 0;
+
+/**
+ * Fast poll uplinks sent since the last update packet
+ */
+static uint8_t fast_poll_idle = 0;
+
+static void abort_updates();
+
+/**
+ * Pending report of the missing fragments when no more arrive in class C,
+ * 0 if none is scheduled
+ */
+static int update_timeout_event = 0;
+
+/**
+ * Missing reports sent since the last update packet
+ */
+static uint8_t update_silent_rounds = 0;
+
+static void arm_update_timeout();
+
+static void report_all_missing_fragments();
+
+/**
+ * Data rate of the last uplink, used to cost the update reception modes
+ */
+static uint8_t last_tx_datarate = 0;
+
+static void select_update_mode(uint8_t packets);
+
+/**
+ * Time taken to handle an UpdateData fragment, in ms
+ */
+static uint32_t fragment_latency_last = 0;
+
+static uint32_t fragment_latency_max = 0;
+
+/**
+ * Data of consecutive fragments written together by process_fragment_batch()
+ */
+static uint8_t fragment_batch[RX_RING_SLOTS * UPDATE_FRAGMENT_SIZE];
+
+static void store_fragment(uint8_t session, int fragment, const uint8_t *data, uint16_t size);
+
+static void store_fragment_run(void *context, uint8_t session, int first,
+                               const uint8_t *data, uint16_t size);
+
+/**
+ * Joins consecutive fragments of a batch into fragment_batch
+ */
+static FragmentBatcher fragment_batcher(fragment_batch, sizeof(fragment_batch),
+                                        UPDATE_FRAGMENT_SIZE, store_fragment_run, NULL);
+
+static void process_fragment_batch();
+
+/**
+ * Fragment interval last requested from the server, in ms
+ */
+static uint32_t fragment_interval = UPDATE_CLASS_C_FRAGMENT_INTERVAL;
+
+/**
+ * Fragments handled in a row without a backlog
+ */
+static uint8_t flow_control_calm = 0;
+
+static uint32_t flow_control_stalls = 0;
+
+static uint8_t staging_queue_depth();
+
+static void update_flow_control(uint8_t queue_depth);
+
+static uint8_t rx_ring_head = 0;
+
+static uint8_t rx_ring_count = 0;
+
+/**
+ * Pending handling of the RX ring, 0 if none is scheduled
+ */
+static int rx_ring_event = 0;
+
+static void process_rx_ring();
+
+#if RX_RING_STRESS_TEST
+static void inject_stress_downlink();
+#endif
+
+#if SAMPLING_PROFILER
+/**
+ * Samples the program counter of the application thread
+ */
+static SamplingProfiler profiler;
+
+static void dump_profile();
+#endif
+
+/**
+ * Samples the heap statistics into the metrics
+ */
+static void sample_heap();
+
+#if HEAP_MONITOR
+static void report_heap();
+#endif
+
+#if LOAD_GENERATOR
+static const load_size_t load_sizes[] = { LOAD_PAYLOAD_SIZES };
+
+static const load_profile_t load_profile = {
+    LOAD_INTERVAL,
+    LOAD_BURST_INTERVAL,
+    LOAD_BURSTINESS,
+    LOAD_CONFIRMED,
+    load_sizes,
+    sizeof(load_sizes) / sizeof(load_sizes[0])
+};
+
+/**
+ * Seeded from the DevEUI, so boards flashed with the same build do not
+ * send in lockstep
+ */
+static const uint8_t load_device_eui[] = MBED_CONF_LORA_DEVICE_EUI;
+
+static LoadGenerator load_generator(load_profile,
+                                    crc16_ccitt(load_device_eui, sizeof(load_device_eui),
+                                                CRC16_CCITT_INIT));
+
+/**
+ * Pending synthetic frame, 0 until the generator is started
+ */
+static int load_event = 0;
+
+static uint32_t load_sequence = 0;
+
+static void start_load_generator();
+
+static void send_load_frame(uint8_t size, bool confirmed);
+#endif
+
+static void print_rx_metadata(const lorawan_rx_metadata &metadata);
+
+/**
+ * Hands tx_buffer to the stack, counting the mbedtls allocations made
+ * until its TX_DONE or TX error against the uplink path
+ */
+static int16_t send_frame(uint8_t port, uint16_t len, int flags);
+
+static void set_idle_crypto_path();
+
+/**
+ * Pending retry of the application uplink, 0 if none is scheduled
+ */
+static int tx_retry_event = 0;
+
+/**
+ * Set when the next sensor step or telemetry retry could not be scheduled
+ * because the event queue was full, until restart_stalled_events() runs
+ */
+static uint8_t sensor_stalled = 0;
+
+static uint8_t telemetry_stalled = 0;
+
+static void retry_send_message(int delay);
+
+static void restart_stalled_events();
+
+/**
+ * An application message waiting for the stack to accept it
+ */
+typedef struct {
+    uint8_t len;
+    uint8_t data[sizeof(tx_buffer)];
+} uplink_slot_t;
+
+static uplink_slot_t uplink_queue[UPLINK_QUEUE_SIZE];
+
+static uint8_t uplink_queue_head = 0;
+
+static uint8_t uplink_queue_count = 0;
+
+/**
+ * Pending retry of the queued application messages, 0 if none is scheduled
+ */
+static int uplink_queue_event = 0;
+
+/**
+ * Set from CONNECTED until the session is closed
+ */
+static uint8_t lorawan_connected = 0;
+
+/**
+ * Set from a successful send() until TX_DONE or a TX error
+ */
+static uint8_t uplink_in_flight = 0;
+
+/**
+ * Set when the network asked for an uplink that is not yet scheduled
+ */
+static uint8_t uplink_required = 0;
+
+/**
+ * Pending uplink answering the network, 0 if none is scheduled
+ */
+static int required_uplink_event = 0;
+
+/**
+ * Copy of the uplink handed to the stack, resent if transmission fails
+ */
+static uint8_t last_uplink[sizeof(tx_buffer)];
+
+static uint16_t last_uplink_len = 0;
+
+static int tx_error_backoff = TX_ERROR_BACKOFF_MIN;
+
+/**
+ * Set while the session is torn down to rejoin after a crypto error
+ */
+static uint8_t session_reset_pending = 0;
+
+static void rejoin();
+
+/**
+ * Sends payloads larger than tx_buffer as a series of frames
+ */
+static UplinkFragmenter uplink_fragmenter;
+
+/**
+ * Pending frame of a fragmented uplink, 0 if none is scheduled
+ */
+static int uplink_fragment_event = 0;
+
+/**
+ * Port of the uplink handed to the stack, 0 for an empty frame
+ */
+static uint8_t last_uplink_port = 0;
+
+/**
+ * Metrics report sent on SendStats with fragmented uplinks
+ */
+static uint8_t stats_report[METRICS_REPORT_SIZE];
+
+/**
+ * Uplink frame loss last reported by the server, in 1/1000
+ */
+static uint16_t uplink_loss = UPLINK_FEC_DEFAULT_LOSS;
+
+/**
+ * Telemetry records kept until the server acknowledges them
+ */
+static UplinkRetention telemetry_retention;
+
+/**
+ * Telemetry frame waiting for the stack to accept it, resent as is when
+ * send() would block
+ */
+static uint8_t telemetry_frame[sizeof(tx_buffer)];
+
+static uint8_t telemetry_frame_len = 0;
+
+/**
+ * Temperature readings taken since the last telemetry record, compressed
+ * against the predictor of sample_codec.h
+ */
+static SampleEncoder sensor_encoder;
+
+static uint8_t sensor_block[UPLINK_RETENTION_RECORD_SIZE];
+
+/**
+ * Sensor readings taken so far, and the count when the oldest telemetry
+ * record was last sent again to ask for an Ack
+ */
+static uint32_t sensor_readings = 0;
+
+static uint32_t telemetry_ack_request_reading = 0;
+
+/**
+ * Sets the interval to the next reading from the variability of the last ones
+ */
+static AdaptiveSampler sensor_sampler(SENSOR_SAMPLE_INTERVAL_MIN, SENSOR_SAMPLE_INTERVAL_MAX,
+                                      SENSOR_SAMPLE_THRESHOLD);
+
+/**
+ * Reduces the history log to the readings backfilled after an outage
+ */
+static LttbDownsampler history_downsampler;
+
+/**
+ * Largest size of a backfilled reading with its timestamp, used to fit
+ * the backfill to its air time budget whatever the readings
+ */
+#define HISTORY_BACKFILL_POINT_BYTES    (TIMESTAMP_MAX_ENTRY_SIZE + 6)
+
+/**
+ * Backfilled readings, sent as a fragmented uplink:
+ *     "HB" | flags | times length (16 bit BE) | times | readings
+ * with the times coded by timestamp_codec.h, in GPS seconds if bit 0 of
+ * flags is set and else in seconds from boot, and the readings by
+ * sample_codec.h. Both parts are built side by side, each in a region
+ * large enough for HISTORY_BACKFILL_POINTS, then joined.
+ */
+#define HISTORY_BACKFILL_HEADER_SIZE    5
+#define HISTORY_BACKFILL_TIMES_SIZE     (4 + HISTORY_BACKFILL_POINTS * TIMESTAMP_MAX_ENTRY_SIZE)
+#define HISTORY_BACKFILL_VALUES_SIZE    (4 + HISTORY_BACKFILL_POINTS * 6)
+
+static uint8_t history_backfill[HISTORY_BACKFILL_HEADER_SIZE + HISTORY_BACKFILL_TIMES_SIZE
+                                + HISTORY_BACKFILL_VALUES_SIZE];
+
+static TimestampEncoder history_times;
+
+static SampleEncoder history_values;
+
+/**
+ * GPS time minus uptime_seconds(), once device_time_synced is set. The
+ * uptime comes from the monotonic kernel clock, so the logged times stay
+ * ordered whatever an RTC or set_time() does; the offset is only applied
+ * when sending.
+ */
+static uint32_t device_time_offset = 0;
+
+static uint8_t device_time_synced = 0;
+
+static uint32_t uptime_seconds();
+
+/**
+ * Pending step of the history downsampling, 0 if none is scheduled
+ */
+static int history_backfill_event = 0;
+
+/**
+ * Logged readings the running backfill covers, dropped from the log once
+ * its fragmented uplink is sent, and the transfer id, -1 when none runs
+ */
+static uint32_t history_backfill_count = 0;
+
+static int history_backfill_transfer = -1;
+
+static void start_sensor_conversion();
+
+static void request_device_time();
+
+static void uplink_scheduled(uint8_t port, uint16_t packet_len);
+
+static void schedule_uplink_fragment(uint32_t delay);
+
+static void send_uplink_fragment();
+
+static void handle_tx_error(lorawan_event_t event);
+
+static void send_queued_uplink();
+
+static void print_payload(const uint8_t *data, uint16_t len);
+
+static void schedule_required_uplink(int min_delay);
+
+static void send_required_uplink();
+
+/**
+ * Entry point for application
+ */
+int main(void)
+{
+    // count the allocations of the stack from the start
+    heap_monitor_start();
+
+    // setup tracing
+    setup_trace();
+
+    // before the stack allocates its first mbedtls context
+    crypto_heap_init();
+
+    green_led = ON;
+
+    // stores the status of a call to LoRaWAN protocol
+    lorawan_status_t retcode;
+
+    // Initialize LoRaWAN stack
+    if (lorawan.initialize(&ev_queue) != LORAWAN_STATUS_OK) {
+        printf("\r\n LoRa initialization failed! \r\n");
+        return -1;
+    }
+
+    printf("\r\n Mbed LoRaWANStack initialized \r\n");
+
+    // prepare application callbacks
+    callbacks.events = mbed::callback(lora_event_handler);
+    lorawan.add_app_callbacks(&callbacks);
+
+    // Set number of retries in case of CONFIRMED messages
+    if (lorawan.set_confirmed_msg_retries(CONFIRMED_MSG_RETRY_COUNTER)
+            != LORAWAN_STATUS_OK) {
+        printf("\r\n set_confirmed_msg_retries failed! \r\n\r\n");
+        return -1;
+    }
+
+    printf("\r\n [main]: CONFIRMED message retries : %d \r\n",
+           CONFIRMED_MSG_RETRY_COUNTER);
+
+    // Enable adaptive data rate
+    if (lorawan.enable_adaptive_datarate() != LORAWAN_STATUS_OK) {
+        printf("\r\n enable_adaptive_datarate failed! \r\n");
+        return -1;
+    }
+
+    printf("\r\n Adaptive data  rate (ADR) - Enabled \r\n");
+
+    if (image_flash.init() != 0) {
+        printf("\r\n FlashIAP init failed - delta updates disabled \r\n");
+    }
+
+    if (!ds1820.begin()) {
+        printf("\r\n DS1820 not found \r\n");
+    }
+    sensor_encoder.begin(sensor_block, sizeof(sensor_block));
+#if !LOAD_GENERATOR
+    // the synthetic frames are the only traffic of a load generator build
+    start_sensor_conversion();
+#endif
+
+    if (history_log.init() != 0) {
+        printf("\r\n History log disabled - readings are dropped during outages \r\n");
+    }
+    ev_queue.call_every(DEVICE_TIME_SYNC_INTERVAL, request_device_time);
+    ev_queue.call_every(EVENT_RESTART_INTERVAL, restart_stalled_events);
+
+    crypto_heap_set_path(CRYPTO_PATH_JOIN);
+    retcode = lorawan.connect();
+
+    if (retcode == LORAWAN_STATUS_OK ||
+            retcode == LORAWAN_STATUS_CONNECT_IN_PROGRESS) {
+    } else {
+        printf("\r\n Connection error, code = %d \r\n", retcode);
+        return -1;
+    }
+
+    printf("\r\n Connection - In Progress ...\r\n");
+
+#if RX_RING_STRESS_TEST
+    ev_queue.call_every(RX_RING_STRESS_INTERVAL, inject_stress_downlink);
+#endif
+
+#if SAMPLING_PROFILER
+    profiler.start();
+    ev_queue.call_every(PROFILER_DUMP_INTERVAL, dump_profile);
+#endif
+
+#if HEAP_MONITOR
+    ev_queue.call_every(HEAP_MONITOR_INTERVAL, report_heap);
+#endif
+
+    // make your event queue dispatching events forever
+    ev_queue.dispatch_forever();
+
+    return 0;
+}
+
+static void switch_to_class_c()
+{
+    printf("\r\n Switching to class C... \r\n");
+    int16_t retcode = lorawan.set_device_class(CLASS_C);
+    if (retcode == LORAWAN_STATUS_OK) {
+        printf("\r\n Switched to class C - Successful!\r\n");
+    }
+    blue_led = ON;
+    green_led = OFF;
+    is_class_c = 1;
+    send_specific_message("ClassCSwitch");
+}
+
+static void switch_to_class_a()
+{
+    printf("\r\n Switching to class A... \r\n");
+    int16_t retcode = lorawan.set_device_class(CLASS_A);
+    if (retcode == LORAWAN_STATUS_OK) {
+        printf("\r\n switched to class A - Successful!\r\n");
+    }
+    blue_led = OFF;
+    green_led = ON;
+    is_class_c = 0;
+    is_fast_poll = 0;
+    send_specific_message("ClassAInit");
+}
+
+static int16_t send_frame(uint8_t port, uint16_t len, int flags)
+{
+    // until TX_DONE the stack may secure the frame later (duty cycle) or
+    // again (confirmed retries), and checks the answer in the RX windows
+    crypto_heap_set_path(CRYPTO_PATH_UPLINK);
+    int16_t retcode = lorawan.send(port, tx_buffer, len, flags);
+    if (retcode < 0 && !uplink_in_flight) {
+        set_idle_crypto_path();
+    }
+    return retcode;
+}
+
+/**
+ * Counts the mbedtls allocations made outside of an uplink against the
+ * downlinks, or against the join until the session is up
+ */
+static void set_idle_crypto_path()
+{
+    crypto_heap_set_path(lorawan_connected ? CRYPTO_PATH_DOWNLINK : CRYPTO_PATH_JOIN);
+}
+
+/**
+ * Sends a message to the Network Server
+ */
+static void send_message()
+{
+    if (tx_retry_event) {
+        ev_queue.cancel(tx_retry_event);
+        tx_retry_event = 0;
+    }
+    if (is_class_c)
+        return;
+    uint16_t packet_len;
+    int16_t retcode;
+
+    // records the server reported missing go out before new ones
+    if (telemetry_frame_len == 0) {
+        telemetry_frame_len = telemetry_retention.next_gap(telemetry_frame);
+    }
+    if (telemetry_frame_len == 0) {
+        if (sensor_encoder.samples() == 0) {
+            // nothing read since the last record, try again after the next reading
+            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
+                retry_send_message(sensor_sampler.interval());
+            }
+            return;
+        }
+
+        if (telemetry_retention.full()) {
+            // every slot waits for an Ack: the readings stay in the block,
+            // and the oldest record goes out again once per reading so the
+            // server answers with one
+            if (telemetry_ack_request_reading == sensor_readings) {
+                if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
+                    retry_send_message(sensor_sampler.interval());
+                }
+                return;
+            }
+            telemetry_ack_request_reading = sensor_readings;
+            telemetry_frame_len = telemetry_retention.resend_oldest(telemetry_frame);
+        } else {
+            printf("\r\n %d readings compressed to %d bits \r\n",
+                   sensor_encoder.samples(), (int) sensor_encoder.bits());
+            telemetry_frame_len = telemetry_retention.add(sensor_block, sensor_encoder.bytes(),
+                                                          telemetry_frame);
+            sensor_encoder.begin(sensor_block, sizeof(sensor_block));
+        }
+    }
+
+    packet_len = telemetry_frame_len;
+    memcpy(tx_buffer, telemetry_frame, packet_len);
+
+    retcode = send_frame(TELEMETRY_PORT, packet_len, MSG_UNCONFIRMED_FLAG);
+
+    if (retcode < 0) {
+        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
+        : printf("\r\n send() - Error code %d \r\n", retcode);
+
+        if (retcode == LORAWAN_STATUS_WOULD_BLOCK) {
+            //retry in 3 seconds
+            if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 0) {
+                retry_send_message(3000);
+            }
+        }
+        return;
+    }
+
+    uplink_scheduled(TELEMETRY_PORT, packet_len);
+    telemetry_frame_len = 0;
+    printf("\r\n %d bytes scheduled for transmission \r\n", retcode);
+    printf(" With telemetry record %d: ", (tx_buffer[0] << 8) | tx_buffer[1]);
+    print_payload(tx_buffer + UPLINK_RETENTION_HEADER_SIZE,
+                  packet_len - UPLINK_RETENTION_HEADER_SIZE);
+    memset(tx_buffer, 0, sizeof(tx_buffer));
+}
+
+/**
+ * Schedules send_message() in delay ms
+ */
+static void retry_send_message(int delay)
+{
+    tx_retry_event = ev_queue.call_in(delay, send_message);
+    if (tx_retry_event == 0) {
+        printf("\r\n Event queue full - telemetry retry postponed \r\n");
+        telemetry_stalled = 1;
+    }
+}
+
+/**
+ * Schedules the next step of the sensor readings in delay ms
+ */
+static void schedule_sensor_step(int delay, void (*step)())
+{
+    if (ev_queue.call_in(delay, step) == 0) {
+        printf("\r\n Event queue full - sensor readings postponed \r\n");
+        sensor_stalled = 1;
+    }
+}
+
+/**
+ * Runs every EVENT_RESTART_INTERVAL from an event allocated at startup,
+ * so it still runs when the queue is full
+ */
+static void restart_stalled_events()
+{
+    if (sensor_stalled) {
+        sensor_stalled = 0;
+        start_sensor_conversion();
+    }
+    if (telemetry_stalled) {
+        telemetry_stalled = 0;
+        send_message();
+    }
+}
+
+/**
+ * Seconds since boot from the kernel clock, which never jumps
+ */
+static uint32_t uptime_seconds()
+{
+    return Kernel::Clock::now().time_since_epoch().count() / 1000;
+}
+
+/**
+ * Adds the converted reading to the block of the next telemetry record
+ * and schedules the next conversion
+ */
+static void read_sensor()
+{
+    int32_t sample = ds1820.read();
+    sensor_readings++;
+    if (!sensor_encoder.add(sample)) {
+        // no uplink for a while, keep the reading for the backfill
+        history_point_t point = { uptime_seconds(), sample };
+        if (history_log.append(point) != 0) {
+            metric_inc(METRIC_SENSOR_DROPPED);
+            printf("\r\n Sensor block full - %ld readings dropped \r\n",
+                   (long) metric_value(METRIC_SENSOR_DROPPED));
+        }
+    }
+
+    uint32_t interval = sensor_sampler.update(sample);
+    metric_set(METRIC_SENSOR_INTERVAL, interval);
+    schedule_sensor_step(interval - DS1820_CONVERSION_TIME, start_sensor_conversion);
+}
+
+/**
+ * Starts a temperature conversion, read once it completes
+ */
+static void start_sensor_conversion()
+{
+    metric_inc(METRIC_SENSOR_CONVERSIONS);
+    ds1820.startConversion();
+    schedule_sensor_step(DS1820_CONVERSION_TIME, read_sensor);
+}
+
+/**
+ * Marks an uplink as handed over to the stack. Anything the network asked
+ * us to answer (MAC commands, frame pending) goes out with it.
+ */
+static void uplink_scheduled(uint8_t port, uint16_t packet_len)
+{
+    memcpy(last_uplink, tx_buffer, packet_len);
+    last_uplink_len = packet_len;
+    last_uplink_port = port;
+    uplink_in_flight = 1;
+    uplink_required = 0;
+    if (required_uplink_event) {
+        ev_queue.cancel(required_uplink_event);
+        required_uplink_event = 0;
+    }
+}
+
+/**
+ * Schedules an uplink when the network needs one: MAC command answers,
+ * acknowledging a confirmed class C downlink, or opening the next RX windows
+ * because more downlinks are queued (frame pending). Requests arriving
+ * while one is already scheduled or in flight are merged into it.
+ */
+static void schedule_required_uplink(int min_delay)
+{
+    uplink_required = 1;
+    if (uplink_in_flight || required_uplink_event) {
+        return;
+    }
+
+    int backoff = 0;
+    if (lorawan.get_backoff_metadata(backoff) != LORAWAN_STATUS_OK) {
+        backoff = 0;
+    }
+    if (backoff < min_delay) {
+        backoff = min_delay;
+    }
+
+    printf("\r\n Uplink required - sending in %d ms \r\n", backoff);
+    required_uplink_event = ev_queue.call_in(backoff, send_required_uplink);
+}
+
+/**
+ * Sends the uplink scheduled by schedule_required_uplink(). Pending
+ * application data is sent in preference to an empty frame so the answer
+ * costs no extra airtime.
+ */
+static void send_required_uplink()
+{
+    required_uplink_event = 0;
+    if (!uplink_required || uplink_in_flight)
+        return;
+
+    if (uplink_queue_count) {
+        send_queued_uplink();
+        return;
+    }
+
+    if (tx_retry_event && (telemetry_frame_len || sensor_encoder.samples())) {
+        send_message();
+        return;
+    }
+
+    if (uplink_fragmenter.busy()) {
+        send_uplink_fragment();
+        return;
+    }
+
+    int16_t retcode = send_frame(MBED_CONF_LORA_APP_PORT, 0, MSG_UNCONFIRMED_FLAG);
+
+    if (retcode < 0) {
+        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
+        : printf("\r\n send() - Error code %d \r\n", retcode);
+
+        if (retcode == LORAWAN_STATUS_WOULD_BLOCK || retcode == LORAWAN_STATUS_BUSY) {
+            schedule_required_uplink(1000);
+        }
+        return;
+    }
+
+    uplink_scheduled(0, 0);
+    printf("\r\n Empty uplink scheduled for the Network Server \r\n");
+}
+
+/**
+ * Sends the oldest queued application message. It stays queued and is
+ * retried in 3 seconds while the stack would block.
+ */
+static void send_queued_uplink()
+{
+    if (uplink_queue_event) {
+        ev_queue.cancel(uplink_queue_event);
+        uplink_queue_event = 0;
+    }
+    if (uplink_queue_count == 0 || uplink_in_flight)
+        return;
+
+    uplink_slot_t *message = &uplink_queue[uplink_queue_head];
+    uint16_t packet_len = message->len;
+    memcpy(tx_buffer, message->data, packet_len);
+
+    int16_t retcode = send_frame(MBED_CONF_LORA_APP_PORT, packet_len, MSG_UNCONFIRMED_FLAG);
+
+    if (retcode < 0) {
+        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
+        : printf("\r\n send() - Error code %d \r\n", retcode);
+
+        if (retcode == LORAWAN_STATUS_WOULD_BLOCK || retcode == LORAWAN_STATUS_BUSY) {
+            //retry in 3 seconds
+            uplink_queue_event = ev_queue.call_in(3000, send_queued_uplink);
+        } else {
+            printf("\r\n Dropping message: ");
+            print_payload(message->data, message->len);
+            uplink_queue_head = (uplink_queue_head + 1) % UPLINK_QUEUE_SIZE;
+            uplink_queue_count--;
+        }
+        return;
+    }
+
+    uplink_scheduled(MBED_CONF_LORA_APP_PORT, packet_len);
+    printf("\r\n %d bytes scheduled for transmission \r\n", retcode);
+    printf(" With the message: ");
+    print_payload(tx_buffer, packet_len);
+    memset(tx_buffer, 0, sizeof(tx_buffer));
+    uplink_queue_head = (uplink_queue_head + 1) % UPLINK_QUEUE_SIZE;
+    uplink_queue_count--;
+}
+
+/**
+ * Puts the uplink that failed back at the front of the queue.
+ * An empty frame is not requeued; it is resent only if still required.
+ * Neither is a frame of a fragmented uplink: the fragmenter has not moved
+ * past it and builds it again, nor a telemetry record: it stays retained
+ * and the next acknowledgement reports it missing.
+ */
+static void requeue_last_uplink()
+{
+    uint8_t port = last_uplink_port;
+    last_uplink_port = 0;
+    if (last_uplink_len == 0 || port != MBED_CONF_LORA_APP_PORT) {
+        return;
+    }
+
+    if (uplink_queue_count == UPLINK_QUEUE_SIZE) {
+        metric_inc(METRIC_TX_DROPPED);
+        printf("\r\n Cannot requeue, dropping failed uplink \r\n");
+        return;
+    }
+
+    uplink_queue_head = (uplink_queue_head + UPLINK_QUEUE_SIZE - 1) % UPLINK_QUEUE_SIZE;
+    memcpy(uplink_queue[uplink_queue_head].data, last_uplink, last_uplink_len);
+    uplink_queue[uplink_queue_head].len = last_uplink_len;
+    uplink_queue_count++;
+    last_uplink_len = 0;
+    metric_inc(METRIC_TX_REQUEUED);
+}
+
+/**
+ * Retries the queued uplinks after the error backoff, which doubles on
+ * every consecutive failure.
+ */
+static void retry_with_backoff()
+{
+    if (uplink_queue_count == 0 && !uplink_fragmenter.busy()) {
+        return;
+    }
+
+    printf("\r\n Resending failed uplink in %d ms \r\n", tx_error_backoff);
+    if (uplink_queue_count) {
+        if (uplink_queue_event) {
+            ev_queue.cancel(uplink_queue_event);
+        }
+        uplink_queue_event = ev_queue.call_in(tx_error_backoff, send_queued_uplink);
+    } else {
+        schedule_uplink_fragment(tx_error_backoff);
+    }
+
+    tx_error_backoff *= 2;
+    if (tx_error_backoff > TX_ERROR_BACKOFF_MAX) {
+        tx_error_backoff = TX_ERROR_BACKOFF_MAX;
+    }
+}
+
+static void print_tx_error_stats()
+{
+    printf("\r\n TX errors - timeout: %ld error: %ld crypto: %ld scheduling: %ld\r\n",
+           (long) metric_value(METRIC_TX_TIMEOUTS), (long) metric_value(METRIC_TX_ERRORS),
+           (long) metric_value(METRIC_TX_CRYPTO_ERRORS),
+           (long) metric_value(METRIC_TX_SCHEDULING_ERRORS));
+    printf(" requeued: %ld dropped: %ld session resets: %ld\r\n",
+           (long) metric_value(METRIC_TX_REQUEUED), (long) metric_value(METRIC_TX_DROPPED),
+           (long) metric_value(METRIC_SESSION_RESETS));
+    radio_health.print_stats();
+}
+
+/**
+ * Recovers from a failed transmission according to its cause:
+ * - scheduling errors and generic errors resend the uplink with backoff
+ * - timeouts are resent too; the radio health monitor reinitializes the
+ *   radio once they repeat
+ * - crypto errors tear down the session and join again
+ */
+static void handle_tx_error(lorawan_event_t event)
+{
+    switch (event) {
+        case TX_SCHEDULING_ERROR:
+            metric_inc(METRIC_TX_SCHEDULING_ERRORS);
+            requeue_last_uplink();
+            retry_with_backoff();
+            break;
+        case TX_TIMEOUT:
+            metric_inc(METRIC_TX_TIMEOUTS);
+            radio_health.on_error(event);
+            requeue_last_uplink();
+            retry_with_backoff();
+            break;
+        case TX_CRYPTO_ERROR:
+            metric_inc(METRIC_TX_CRYPTO_ERRORS);
+            // resent from the queue once CONNECTED again
+            requeue_last_uplink();
+            if (!session_reset_pending) {
+                printf("\r\n Crypto error - resetting session \r\n");
+                session_reset_pending = 1;
+                metric_inc(METRIC_SESSION_RESETS);
+                lorawan.shutdown();
+            }
+            break;
+        default:
+            metric_inc(METRIC_TX_ERRORS);
+            requeue_last_uplink();
+            retry_with_backoff();
+            break;
+    }
+
+    print_tx_error_stats();
+}
+
+/**
+ * Joins again after the session was reset, retrying with the TX error
+ * backoff while the stack cannot start the join
+ */
+static void rejoin()
+{
+    crypto_heap_set_path(CRYPTO_PATH_JOIN);
+    lorawan_status_t retcode = lorawan.connect();
+    if (retcode == LORAWAN_STATUS_OK || retcode == LORAWAN_STATUS_CONNECT_IN_PROGRESS) {
+        return;
+    }
+
+    printf("\r\n Rejoin error, code = %d - retrying in %d ms \r\n", retcode, tx_error_backoff);
+    ev_queue.call_in(tx_error_backoff, rejoin);
+    tx_error_backoff *= 2;
+    if (tx_error_backoff > TX_ERROR_BACKOFF_MAX) {
+        tx_error_backoff = TX_ERROR_BACKOFF_MAX;
+    }
+}
+
+/**
+ * Starts sending a payload larger than tx_buffer as fragmented uplinks on
+ * UPLINK_FRAGMENT_PORT. The data must stay valid until the transfer ends.
+ */
+static bool send_large_uplink(const uint8_t *data, uint32_t size)
+{
+#if LOAD_GENERATOR
+    printf("\r\n Fragmented uplink of %lu bytes not sent - load generator running \r\n",
+           (unsigned long) size);
+    return false;
+#endif
+    uint8_t group = uplink_fec_group_size(uplink_loss);
+    int transfer = uplink_fragmenter.start(data, size, sizeof(tx_buffer), group);
+    if (transfer < 0) {
+        printf("\r\n Cannot start fragmented uplink of %lu bytes \r\n", (unsigned long) size);
+        return false;
+    }
+
+    printf("\r\n Fragmented uplink %d: %lu bytes in %d frames, parity every %d frames \r\n",
+           transfer, (unsigned long) size, uplink_fragmenter.frame_count(), group);
+    schedule_uplink_fragment(0);
+    return true;
+}
+
+static void schedule_uplink_fragment(uint32_t delay)
+{
+    if (uplink_fragment_event) {
+        ev_queue.cancel(uplink_fragment_event);
+    }
+    uplink_fragment_event = ev_queue.call_in(delay, send_uplink_fragment);
+}
+
+/**
+ * Sends the next frame of the fragmented uplink. Application messages go
+ * first; the frame is sent after their TX_DONE.
+ */
+static void send_uplink_fragment()
+{
+    uplink_fragment_event = 0;
+    if (uplink_in_flight || uplink_queue_count) {
+        return;
+    }
+
+    uint8_t packet_len = uplink_fragmenter.next_frame(tx_buffer);
+    if (packet_len == 0) {
+        return;
+    }
+
+    int16_t retcode = send_frame(UPLINK_FRAGMENT_PORT, packet_len, MSG_UNCONFIRMED_FLAG);
+
+    if (retcode < 0) {
+        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
+        : printf("\r\n send() - Error code %d \r\n", retcode);
+
+        int backoff = 0;
+        if (lorawan.get_backoff_metadata(backoff) != LORAWAN_STATUS_OK || backoff < 1000) {
+            backoff = 1000;
+        }
+        schedule_uplink_fragment(backoff);
+        return;
+    }
+
+    uplink_scheduled(UPLINK_FRAGMENT_PORT, packet_len);
+    printf("\r\n Frame %d of %d of fragmented uplink %d scheduled \r\n",
+           uplink_fragmenter.next_index() + 1, uplink_fragmenter.frame_count(),
+           uplink_fragmenter.transfer());
+    memset(tx_buffer, 0, sizeof(tx_buffer));
+}
+
+/**
+ * Drops the backfilled readings from the log once their transfer is sent.
+ * Readings logged since then stay for the next backfill.
+ */
+static void history_backfill_sent()
+{
+    history_log.drop(history_backfill_count);
+    history_backfill_transfer = -1;
+    printf("\r\n Backfill sent - %lu readings left in the log \r\n",
+           (unsigned long) history_log.count());
+}
+
+/**
+ * Moves the fragmented uplink on after TX_DONE, and schedules its next
+ * frame once the airtime budget of UPLINK_FRAGMENT_DUTY_CYCLE allows.
+ */
+static void uplink_fragment_done()
+{
+    if (last_uplink_port == UPLINK_FRAGMENT_PORT) {
+        last_uplink_port = 0;
+        uplink_fragmenter.frame_sent();
+        if (!uplink_fragmenter.busy()) {
+            printf("\r\n Fragmented uplink %d sent, %lu parity frames built in %lu us \r\n",
+                   uplink_fragmenter.transfer(), (unsigned long) uplink_fragmenter.parity_built(),
+                   (unsigned long) uplink_fragmenter.parity_time());
+            if (uplink_fragmenter.transfer() == history_backfill_transfer) {
+                history_backfill_sent();
+            }
+            return;
+        }
+    }
+
+    if (uplink_fragmenter.busy()) {
+        schedule_uplink_fragment(UplinkFragmenter::pacing_delay(last_tx_datarate,
+                                                                sizeof(tx_buffer)));
+    }
+}
+
+/**
+ * Asks the network for the time with the next uplink
+ */
+static void request_device_time()
+{
+    lorawan_status_t status = lorawan.add_device_time_request();
+    if (status != LORAWAN_STATUS_OK) {
+        printf("\r\n DeviceTime request failed: %d \r\n", status);
+    }
+}
+
+/**
+ * Takes the network time from the DeviceTime answer
+ */
+static void device_time_synched()
+{
+    // GPS time from the stack, in ms
+    uint32_t gps_seconds = lorawan.get_current_gps_time() / 1000;
+    device_time_offset = gps_seconds - uptime_seconds();
+    device_time_synced = 1;
+    printf("\r\n Device time synchronized - GPS time %lu s \r\n",
+           (unsigned long) gps_seconds);
+}
+
+/**
+ * Selects the next backfilled reading, one per event so flash reads do
+ * not hold up the radio events, and sends them all once selected
+ */
+static void history_backfill_step()
+{
+    history_point_t point;
+    // both regions are sized for the worst case, so neither fills up
+    if (history_downsampler.next(point) && history_values.add(point.value)
+            && history_times.add(point.time)) {
+        history_backfill_event = ev_queue.call(history_backfill_step);
+        return;
+    }
+
+    uint16_t times_len = history_times.finish();
+    uint8_t *times = history_backfill + HISTORY_BACKFILL_HEADER_SIZE;
+    history_backfill[3] = times_len >> 8;
+    history_backfill[4] = times_len;
+    memmove(times + times_len, times + HISTORY_BACKFILL_TIMES_SIZE, history_values.bytes());
+    uint16_t len = HISTORY_BACKFILL_HEADER_SIZE + times_len + history_values.bytes();
+
+    history_backfill_event = 0;
+    printf("\r\n Backfilling %d of %lu logged readings in %d bytes \r\n",
+           history_times.count(), (unsigned long) history_backfill_count, len);
+    if (!send_large_uplink(history_backfill, len)) {
+        // keep the log, the next downlink starts the backfill again
+        return;
+    }
+    history_backfill_transfer = uplink_fragmenter.transfer();
+}
+
+/**
+ * Starts backfilling the readings logged during an outage, reduced to the
+ * air time budget of HISTORY_BACKFILL_AIRTIME at the last data rate.
+ * Called when a downlink shows the network is reachable again.
+ */
+static void start_history_backfill()
+{
+    if (LOAD_GENERATOR || history_log.count() == 0 || history_backfill_event
+            || uplink_fragmenter.busy()) {
+        return;
+    }
+
+    uint32_t frame_air = lora_time_on_air(last_tx_datarate,
+                                          sizeof(tx_buffer) + UPLINK_FRAME_PHY_OVERHEAD);
+    uint32_t frames = HISTORY_BACKFILL_AIRTIME / (frame_air ? frame_air : 1);
+    uint8_t group = uplink_fec_group_size(uplink_loss);
+    if (group) {
+        // leave room for the parity frames
+        frames = frames * group / (group + 1);
+    }
+    uint32_t budget = frames * (sizeof(tx_buffer) - UPLINK_FRAME_HEADER_SIZE);
+    // the header, then 4 bytes at the start of the times and of the readings
+    uint32_t fixed = HISTORY_BACKFILL_HEADER_SIZE + 4 + 4;
+    uint32_t target = budget > fixed ? (budget - fixed) / HISTORY_BACKFILL_POINT_BYTES : 0;
+    if (target > HISTORY_BACKFILL_POINTS) {
+        target = HISTORY_BACKFILL_POINTS;
+    }
+
+    uint8_t *times = history_backfill + HISTORY_BACKFILL_HEADER_SIZE;
+    history_backfill[0] = 'H';
+    history_backfill[1] = 'B';
+    history_backfill[2] = device_time_synced;
+    history_times.begin(times, HISTORY_BACKFILL_TIMES_SIZE, device_time_offset);
+    history_values.begin(times + HISTORY_BACKFILL_TIMES_SIZE, HISTORY_BACKFILL_VALUES_SIZE);
+    history_backfill_count = history_log.count();
+    history_downsampler.begin(&history_log, history_backfill_count, target);
+    history_backfill_event = ev_queue.call(history_backfill_step);
+}
+
+/**
+ * Sends every metric as a fragmented uplink, after printing them
+ */
+static void send_stats_report()
+{
+    if (uplink_fragmenter.busy()) {
+        return;
+    }
+
+    // gauges and totals kept by other modules are sampled for the report
+    metric_set(METRIC_UPLINK_LOSS, uplink_loss);
+    metric_set(METRIC_TELEMETRY_RETAINED, telemetry_retention.retained());
+    metric_inc_to(METRIC_TELEMETRY_RETRANSMITTED, telemetry_retention.retransmitted());
+    metric_inc_to(METRIC_TELEMETRY_DROPPED, telemetry_retention.dropped());
+    metric_set(METRIC_HISTORY_LOGGED, history_log.count());
+    sample_heap();
+    metric_set(METRIC_CRYPTO_HEAP_JOIN, crypto_heap_peak(CRYPTO_PATH_JOIN));
+    metric_set(METRIC_CRYPTO_HEAP_UPLINK, crypto_heap_peak(CRYPTO_PATH_UPLINK));
+    metric_set(METRIC_CRYPTO_HEAP_DOWNLINK, crypto_heap_peak(CRYPTO_PATH_DOWNLINK));
+    metric_set(METRIC_CRYPTO_HEAP_FAILURES, crypto_heap_failures());
+    metrics_print();
+    heap_monitor_print();
+    crypto_heap_print();
+
+    uint16_t len = metrics_serialize(stats_report, sizeof(stats_report));
+    if (len == 0) {
+        printf("\r\n Metrics do not fit METRICS_REPORT_SIZE \r\n");
+        return;
+    }
+    send_large_uplink(stats_report, len);
+}
+
+/**
+ * Handles UplinkLoss<permille>: the share of uplink frames the server
+ * misses, from the gaps in the frame counter. Used to size the parity
+ * groups of the next fragmented uplinks.
+ */
+static void check_uplink_loss(const char *received_msg)
+{
+    if (strncmp(received_msg, "UplinkLoss", 10) != 0) {
+        return;
+    }
+
+    int loss = atoi(received_msg + 10);
+    uplink_loss = loss < 0 ? 0 : loss > 1000 ? 1000 : loss;
+    printf("\r\n Uplink loss %d/1000 - parity every %d frames \r\n",
+           uplink_loss, uplink_fec_group_size(uplink_loss));
+}
+
+/**
+ * Handles Ack<base>,<bitmap>: bit i of the hexadecimal bitmap is set if
+ * the server received telemetry record base + i. Records missing from it
+ * are retransmitted before new ones, and the share missing updates the
+ * uplink loss estimate that sizes the parity groups of fragmented uplinks.
+ */
+static void check_telemetry_ack(const char *received_msg)
+{
+    if (strncmp(received_msg, "Ack", 3) != 0) {
+        return;
+    }
+
+    const char *comma = strchr(received_msg + 3, ',');
+    if (comma == NULL) {
+        return;
+    }
+
+    uint16_t received = 0;
+    uint16_t missing = 0;
+    telemetry_retention.ack(atoi(received_msg + 3), strtoul(comma + 1, NULL, 16),
+                            received, missing);
+    if (received + missing) {
+        uint16_t loss = (uint32_t) missing * 1000 / (received + missing);
+        uplink_loss = (3 * uplink_loss + loss) / 4;
+    }
+
+    printf("\r\n Telemetry ack - received: %d missing: %d retained: %d \r\n",
+           received, missing, telemetry_retention.retained());
+    printf(" retransmitted: %lu dropped: %lu uplink loss: %d/1000 \r\n",
+           (unsigned long) telemetry_retention.retransmitted(),
+           (unsigned long) telemetry_retention.dropped(), uplink_loss);
+}
+
+/**
+ * Handles UplinkResume<transfer>,<frame>: the server asks for the running
+ * fragmented uplink again from the given data frame (0-based)
+ */
+static void check_uplink_resume(const char *received_msg)
+{
+    if (strncmp(received_msg, "UplinkResume", 12) != 0) {
+        return;
+    }
+
+    const char *comma = strchr(received_msg + 12, ',');
+    if (comma == NULL) {
+        return;
+    }
+
+    uplink_fragmenter.resume(atoi(received_msg + 12), atoi(comma + 1));
+    printf("\r\n Fragmented uplink resumes at frame %d \r\n",
+           uplink_fragmenter.next_index() + 1);
+    if (!uplink_in_flight) {
+        schedule_uplink_fragment(0);
+    }
+}
+
+/**
+ * Sends a specific message to the Network Server
+ */
+static void send_specific_message(string message)
+{
+    if (is_class_c)
+        return;
+
+    if (queue_uplink(message.c_str(), 0)) {
+        send_queued_uplink();
+    }
+}
+
+/**
+ * Adds a text message to the uplink queue. If replace_len is non-zero, a
+ * queued message starting with the same replace_len characters is updated
+ * in place instead, so only the latest value of a setting is sent.
+ */
+static bool queue_uplink(const char *message, size_t replace_len)
+{
+    size_t len = strlen(message);
+    if (len > sizeof(tx_buffer)) {
+        printf("\r\n Message too long for tx_buffer: %s \r\n", message);
+        return false;
+    }
+
+    return queue_uplink((const uint8_t *) message, len, replace_len);
+}
+
+/**
+ * Adds a binary message to the uplink queue, see above
+ */
+static bool queue_uplink(const uint8_t *data, uint8_t len, size_t replace_len)
+{
+    if (replace_len) {
+        for (uint8_t i = 0; i < uplink_queue_count; i++) {
+            uplink_slot_t *queued = &uplink_queue[(uplink_queue_head + i) % UPLINK_QUEUE_SIZE];
+            if (queued->len >= replace_len && memcmp(queued->data, data, replace_len) == 0) {
+                memcpy(queued->data, data, len);
+                queued->len = len;
+                return true;
+            }
+        }
+    }
+
+    if (uplink_queue_count == UPLINK_QUEUE_SIZE) {
+        printf("\r\n Uplink queue full, dropping: ");
+        print_payload(data, len);
+        return false;
+    }
+
+    uplink_slot_t *tail = &uplink_queue[(uplink_queue_head + uplink_queue_count) % UPLINK_QUEUE_SIZE];
+    memcpy(tail->data, data, len);
+    tail->len = len;
+    uplink_queue_count++;
+    return true;
+}
+
+/**
+ * Prints an uplink as text, or in hex if it holds binary data
+ */
+static void print_payload(const uint8_t *data, uint16_t len)
+{
+    bool text = true;
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] < 0x20 || data[i] > 0x7e) {
+            text = false;
+        }
+    }
+
+    if (text) {
+        printf("%.*s\r\n", len, (const char *) data);
+        return;
+    }
+
+    for (uint16_t i = 0; i < len; i++) {
+        printf("%02x ", data[i]);
+    }
+    printf("\r\n");
+}
+
+/**
+ * Reserves the next free RX slot, or returns NULL and counts an overrun
+ * when the application has not caught up with the previous downlinks.
+ */
+static rx_slot_t *reserve_rx_slot()
+{
+    if (rx_ring_count == RX_RING_SLOTS) {
+        metric_inc(METRIC_RX_OVERRUNS);
+        printf("\r\n RX ring full - downlink dropped (%ld overruns) \r\n",
+               (long) metric_value(METRIC_RX_OVERRUNS));
+        return NULL;
+    }
+
+    return &rx_ring[(rx_ring_head + rx_ring_count) % RX_RING_SLOTS];
+}
+
+/**
+ * Hands the slot filled after reserve_rx_slot() over to process_rx_ring()
+ */
+static void commit_rx_slot(rx_slot_t *slot)
+{
+    slot->data[slot->len] = '\0';
+    rx_ring_count++;
+    metric_max(METRIC_RX_HIGH_WATER, rx_ring_count);
+
+    if (!rx_ring_event) {
+        rx_ring_event = ev_queue.call(process_rx_ring);
+    }
+}
+
+/**
+ * Receive a message from the Network Server
+ *
+ * Only copies the downlink and its metadata into a free RX slot, so the
+ * stack can take the next one while the previous is still being handled.
+ */
+static void receive_message()
+{
+    metric_inc(METRIC_RX_RECEIVED);
+    printf("\r\n Packets receive count: %ld \r\n", (long) metric_value(METRIC_RX_RECEIVED));
+
+    rx_slot_t *slot = reserve_rx_slot();
+    if (slot == NULL) {
+        return;
+    }
+
+    // retcode is also the number of bytes in the message ? :-P
+    int16_t retcode = lorawan.receive(slot->data, sizeof(slot->data) - 1,
+                                      slot->port, slot->flags);
+
+    if (retcode == -1001) {
+        printf("\r\n LoRaMAC have nothing to read. Probably just an ACK \r\n");
+        return;
+    } else if (retcode < 0) {
+        printf("\r\n receive() - Error code %d \r\n", retcode);
+        return;
+    }
+
+    slot->len = retcode;
+    lorawan.get_rx_metadata(slot->metadata);
+    commit_rx_slot(slot);
+}
+
+/**
+ * Handles the oldest downlink in the RX ring, then yields to the event
+ * queue before the next one so stack events are not held back.
+ */
+static void process_rx_ring()
+{
+    rx_ring_event = 0;
+    if (rx_ring_count == 0) {
+        return;
+    }
+
+    rx_slot_t *slot = &rx_ring[rx_ring_head];
+
+    // Several fragments waiting: skip the per-message logging
+    if (staging_queue_depth() > 1 && strncmp((const char *) slot->data, "UpdateData", 10) == 0) {
+        process_fragment_batch();
+        if (rx_ring_count) {
+            rx_ring_event = ev_queue.call(process_rx_ring);
+        }
+        return;
+    }
+
+    print_rx_metadata(slot->metadata);
+
+    printf(" RX Data on port %u (%d bytes): ", slot->port, slot->len);
+    for (uint8_t i = 0; i < slot->len; i++) {
+        printf("%02x ", slot->data[i]);
+    }
+    printf("\r\n");
+
+    auto received_msg = (char *) slot->data;
+
+    printf("\r\n With message: %s \r\n", received_msg);
+
+    if (strcmp(received_msg, "ClassCSwitch") == 0) {
+        printf("\r\n We should switch to class C if not already \r\n");
+
+        switch_to_class_c();
+    }
+
+    if (strcmp(received_msg, "ClassASwitch") == 0) {
+        printf("\r\n We should switch to class A if not already \r\n");
+
+        switch_to_class_a();
+    }
+
+    printf("\r\n");
+
+    check_if_update(received_msg);
+
+    keep_unchanged_blocks(received_msg);
+
+    if (strcmp(received_msg, "SendStats") == 0) {
+        send_stats_report();
+    }
+
+    check_uplink_resume(received_msg);
+
+    check_uplink_loss(received_msg);
+
+    check_telemetry_ack(received_msg);
+
+    update_firmware_counter(received_msg, slot->len);
+
+    rx_ring_head = (rx_ring_head + 1) % RX_RING_SLOTS;
+    rx_ring_count--;
+    if (rx_ring_count) {
+        rx_ring_event = ev_queue.call(process_rx_ring);
+    }
+}
+
+#if RX_RING_STRESS_TEST
+/**
+ * Feeds a synthetic UpdateData fragment into the RX ring as if it had been
+ * received back to back at the fastest RX2 data rate.
+ */
+static void inject_stress_downlink()
+{
+    static uint16_t fragment = 0;
+
+    if (fragment == BLOB_MAX_FRAGMENTS) {
+        // the next session starts once this one was written out
+        if (blob_transport.is_open(UPDATE_FIRMWARE_SESSION)) {
+            return;
+        }
+        fragment = 0;
+    }
+
+    if (fragment == 0 && begin_update(UPDATE_FIRMWARE_SESSION, BLOB_MAX_FRAGMENTS) != 0) {
+        printf("\r\n Stress session could not be opened \r\n");
+        return;
+    }
+
+    metric_inc(METRIC_RX_RECEIVED);
+    rx_slot_t *slot = reserve_rx_slot();
+    if (slot == NULL) {
+        fragment++;
+        return;
+    }
+
+    int len = sprintf((char *) slot->data, "UpdateData%d:", fragment);
+    uint8_t *data = slot->data + len;
+    memset(data, 0xA5, UPDATE_FRAGMENT_SIZE);
+    uint8_t number[2] = { (uint8_t)(fragment >> 8), (uint8_t) fragment };
+    uint16_t crc = crc16_ccitt(number, sizeof(number), CRC16_CCITT_INIT);
+    crc = crc16_ccitt(data, UPDATE_FRAGMENT_SIZE, crc);
+    data[UPDATE_FRAGMENT_SIZE] = crc >> 8;
+    data[UPDATE_FRAGMENT_SIZE + 1] = crc;
+    slot->len = len + UPDATE_FRAGMENT_SIZE + 2;
+    fragment++;
+    slot->port = MBED_CONF_LORA_APP_PORT;
+    slot->flags = MSG_UNCONFIRMED_FLAG;
+    memset(&slot->metadata, 0, sizeof(slot->metadata));
+    commit_rx_slot(slot);
+
+    if (fragment % 32 == 0) {
+        printf("\r\n RX ring stress - %ld received, high water %ld/%d, %ld overruns \r\n",
+               (long) metric_value(METRIC_RX_RECEIVED), (long) metric_value(METRIC_RX_HIGH_WATER),
+               RX_RING_SLOTS, (long) metric_value(METRIC_RX_OVERRUNS));
+    }
+}
+#endif
+
+#if SAMPLING_PROFILER
+/**
+ * Prints the samples of the last period and starts a new one
+ */
+static void dump_profile()
+{
+    profiler.stop();
+    profiler.dump();
+    profiler.reset();
+    profiler.start();
+}
+#endif
+
+static void sample_heap()
+{
+    heap_monitor_sample();
+    const heap_stats_t &heap = heap_monitor_stats();
+    metric_set(METRIC_HEAP_USED, heap.used);
+    metric_set(METRIC_HEAP_PEAK, heap.peak);
+    metric_set(METRIC_HEAP_LIVE, heap.live);
+    metric_inc_to(METRIC_HEAP_ALLOCATIONS, heap.allocations);
+    metric_set(METRIC_HEAP_FAILURES, heap.failures);
+    metric_set(METRIC_HEAP_LARGEST_FREE, heap.largest_free);
+    metric_set(METRIC_HEAP_LOWEST_LARGEST_FREE, heap.lowest_largest_free);
+}
+
+#if HEAP_MONITOR
+/**
+ * Prints the heap statistics and allocation sites, for soak test logs
+ */
+static void report_heap()
+{
+    sample_heap();
+    heap_monitor_print();
+}
+#endif
+
+#if LOAD_GENERATOR
+/**
+ * Draws the next synthetic frame and schedules it
+ */
+static void schedule_load_frame()
+{
+    load_frame_t frame;
+    load_generator.next(frame);
+    load_event = ev_queue.call_in(frame.delay, send_load_frame, frame.size, frame.confirmed);
+}
+
+/**
+ * Starts the synthetic traffic once joined. It keeps its own schedule
+ * across rejoins.
+ */
+static void start_load_generator()
+{
+    if (load_event) {
+        return;
+    }
+
+    if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
+        printf("\r\n Load generator limited by the duty cycle \r\n");
+    }
+    printf("\r\n Load generator: a frame every %lu ms on average, %d/1000 in bursts, "
+           "%d/1000 confirmed \r\n", (unsigned long) LOAD_INTERVAL, LOAD_BURSTINESS,
+           LOAD_CONFIRMED);
+    schedule_load_frame();
+}
+
+/**
+ * Sends one synthetic frame: its sequence number, then filler. Frames the
+ * stack cannot take right away are not retried, they count as rejected,
+ * so the offered load keeps to the profile.
+ */
+static void send_load_frame(uint8_t size, bool confirmed)
+{
+    schedule_load_frame();
+
+    if (size > sizeof(tx_buffer)) {
+        size = sizeof(tx_buffer);
+    }
+    uint8_t header[4] = {
+        (uint8_t)(load_sequence >> 24), (uint8_t)(load_sequence >> 16),
+        (uint8_t)(load_sequence >> 8), (uint8_t) load_sequence
+    };
+    memset(tx_buffer, 0xA5, size);
+    memcpy(tx_buffer, header, size < sizeof(header) ? size : sizeof(header));
+    load_sequence++;
+
+    metric_inc(METRIC_LOAD_OFFERED);
+    int16_t retcode = send_frame(LOAD_GENERATOR_PORT, size,
+                                 confirmed ? MSG_CONFIRMED_FLAG : MSG_UNCONFIRMED_FLAG);
+    if (retcode < 0) {
+        metric_inc(METRIC_LOAD_REJECTED);
+        printf("\r\n Load frame %lu rejected - code %d \r\n",
+               (unsigned long)(load_sequence - 1), retcode);
+        return;
+    }
+
+    uplink_scheduled(LOAD_GENERATOR_PORT, size);
+    metric_inc(METRIC_LOAD_SENT);
+    metric_inc(METRIC_LOAD_BYTES, size);
+    if (confirmed) {
+        metric_inc(METRIC_LOAD_CONFIRMED);
+    }
+    printf("\r\n Load frame %lu: %d bytes%s \r\n", (unsigned long)(load_sequence - 1),
+           size, confirmed ? ", confirmed" : "");
+}
+#endif
+
+static void record_tx_metadata()
+{
+    lorawan_tx_metadata metadata;
+    if (lorawan.get_tx_metadata(metadata) == LORAWAN_STATUS_OK) {
+        last_tx_datarate = metadata.data_rate;
+    }
+}
+
+static void print_rx_metadata(const lorawan_rx_metadata &metadata)
+{
+    printf("\r\n rssi: %d\r\n snr: %d\r\n time on air: %d\r\n datarate: %d\r\n channel: %d\r\n stale: %d\r\n",
+        metadata.rssi, metadata.snr, metadata.rx_toa, metadata.rx_datarate, metadata.channel, metadata.stale);
+}
+
+/**
+ * Handles StartUpdate<n>[,Session<id>][,Delta]. Without a session id the
+ * firmware session is started. A session started while another one is
+ * open joins the reception mode already selected.
+ */
+static void check_if_update(char* received_msg) {
+    if (strncmp(received_msg, "StartUpdate", 11) != 0) {
+        return;
+    }
+
+    char *end;
+    long packets = strtol(received_msg + 11, &end, 10);
+    if (end == received_msg + 11 || packets <= 0 || packets > BLOB_MAX_FRAGMENTS) {
+        printf("\r\n Invalid update size \r\n");
+        return;
+    }
+
+    long session = UPDATE_FIRMWARE_SESSION;
+    if (strncmp(end, ",Session", 8) == 0) {
+        session = strtol(end + 8, &end, 10);
+    }
+    if (session < 0 || session >= BLOB_MAX_SESSIONS) {
+        printf("\r\n Unknown update session %ld \r\n", session);
+        return;
+    }
+
+    if (session == UPDATE_FIRMWARE_SESSION) {
+        printf(" Starting firmware update....\r\n");
+    } else {
+        printf(" Starting data update session %ld....\r\n", session);
+    }
+    printf("\r\n Packet Size of Update: %ld\r\n", packets);
+
+    bool first_session = blob_transport.open_sessions() == 0;
+    if (begin_update(session, packets) != 0) {
+        printf("\r\n Update session %ld could not be opened - update rejected \r\n", session);
+        if (blob_transport.open_sessions() == 0) {
+            arm_update_timeout();
+            switch_to_class_a();
+        }
+        return;
+    }
+
+    if (session == UPDATE_FIRMWARE_SESSION && strcmp(end, ",Delta") == 0) {
+        // describe the image being replaced before pulling fragments
+        block_manifest.begin(MANIFEST_IMAGE_START, running_image_size());
+        queue_manifest();
+    }
+    if (first_session) {
+        select_update_mode(packets);
+    }
+}
 
 /**
- * Event handler.
- *
- * This will be passed to the LoRaWAN stack to queue events for the
- * application which in turn drive the application.
+ * Called by the blob transport once the firmware image is staged
  */
-static void lora_event_handler(lorawan_event_t event);
+static void firmware_received(uint8_t session, uint32_t size)
+{
+    printf("\r\n Update successful!! (%lu bytes)\r\n", (unsigned long) size);
+}
 
 /**
- * Constructing Mbed LoRaWANInterface and passing it the radio object from lora_radio_helper.
+ * Called by the blob transport once a data blob is in its RAM buffer
  */
-static LoRaWANInterface lorawan(radio);
+static void data_blob_received(uint8_t session, uint32_t size)
+{
+    printf("\r\n Data update session %d received (%lu bytes)\r\n",
+           session, (unsigned long) size);
+}
 
 /**
- * Application specific callbacks
+ * Opens a blob transport session for the packets fragments announced.
+ * The firmware goes to the staging area, erased in the background ahead
+ * of the fragments, and data blobs to the session's RAM buffer.
+ * Returns 0 on success or the error of the blob transport.
  */
-static lorawan_app_callbacks_t callbacks;
-
-static uint8_t is_class_c = 0;
-
-static void switch_to_class_c();
+static int begin_update(uint8_t session, uint8_t packets)
+{
+    if (blob_transport.open_sessions() == 0) {
+        fragment_latency_max = 0;
+        fragment_interval = UPDATE_CLASS_C_FRAGMENT_INTERVAL;
+        flow_control_calm = 0;
+        flow_control_stalls = 0;
+    }
 
-static void switch_to_class_a();
+    if (session == UPDATE_FIRMWARE_SESSION) {
+        return blob_transport.open(session, packets, &firmware_sink, firmware_received);
+    }
+    return blob_transport.open(session, packets, &data_sinks[session - 1], data_blob_received);
+}
 
-static uint8_t receive_count = 0;
+#if defined(__ARMCC_VERSION)
+extern uint32_t Load$$LR$$LR_IROM1$$Limit[];
+#elif defined(__GNUC__)
+extern uint32_t __etext[];
+extern uint32_t __data_start__[];
+extern uint32_t __data_end__[];
+#endif
 
-static void check_if_update(char* received_msg);
+/**
+ * Bytes of the running image in flash, from the end of its load region
+ * given by the linker. With other toolchains, the whole flash from
+ * MANIFEST_IMAGE_START is described.
+ */
+static uint32_t running_image_size()
+{
+#if defined(__ARMCC_VERSION)
+    return (uintptr_t) Load$$LR$$LR_IROM1$$Limit - MANIFEST_IMAGE_START;
+#elif defined(__GNUC__)
+    // The initial values of .data are stored right after the code
+    return (uintptr_t) __etext + ((uintptr_t) __data_end__ - (uintptr_t) __data_start__)
+           - MANIFEST_IMAGE_START;
+#else
+    return image_flash.get_flash_start() + image_flash.get_flash_size() - MANIFEST_IMAGE_START;
+#endif
+}
 
-static void update_firmware_counter(char* received_msg);
+/**
+ * Queues the next chunks of the block manifest as uplink slots free up,
+ * hashing the blocks as they go so the manifest is never held in RAM.
+ * One slot is left for the other messages. Each chunk is
+ * 'M' 'F' <block count> <first block> (16 bit big endian each) then per
+ * block the weak checksum (32 bit big endian) and the strong hash.
+ */
+static void queue_manifest()
+{
+    bool queued = false;
+
+    while (!block_manifest.done() && uplink_queue_count < UPLINK_QUEUE_SIZE - 1) {
+        uint8_t chunk[sizeof(tx_buffer)];
+        uint8_t len = 0;
+        chunk[len++] = 'M';
+        chunk[len++] = 'F';
+        chunk[len++] = block_manifest.block_count() >> 8;
+        chunk[len++] = block_manifest.block_count();
+        chunk[len++] = block_manifest.next_block() >> 8;
+        chunk[len++] = block_manifest.next_block();
+
+        while (!block_manifest.done() && len <= sizeof(chunk) - MANIFEST_SIGNATURE_SIZE) {
+            block_signature_t signature;
+            int err = block_manifest.next(signature);
+            if (err) {
+                printf("\r\n Reading block %d of the image failed: %d \r\n",
+                       block_manifest.next_block(), err);
+                block_manifest.cancel();
+                return;
+            }
+            chunk[len++] = signature.weak >> 24;
+            chunk[len++] = signature.weak >> 16;
+            chunk[len++] = signature.weak >> 8;
+            chunk[len++] = signature.weak;
+            memcpy(chunk + len, signature.strong, MANIFEST_STRONG_HASH_SIZE);
+            len += MANIFEST_STRONG_HASH_SIZE;
+        }
 
-static void send_specific_message(string message);
+        queued |= queue_uplink(chunk, len, 0);
 
-static uint8_t update_count = 0;
+        if (block_manifest.done()) {
+            printf("\r\n Manifest of %d blocks hashed - %lu ms per 256 KB \r\n",
+                   block_manifest.block_count(), (unsigned long) block_manifest.ms_per_256k());
+        }
+    }
 
-static uint8_t update_packets = 0;
+    if (queued) {
+        schedule_required_uplink(0);
+    }
+}
 
 /**
- * Entry point for application
+ * Picks how the announced update is received: class A with one empty
+ * uplink per fragment at the duty-cycle rate, or class C, whichever the
+ * energy model says is cheaper at the current data rate.
  */
-int main(void)
+static void select_update_mode(uint8_t packets)
 {
-    // setup tracing
-    setup_trace();
+    if (is_class_c)
+        return;
 
-    green_led = ON;
+    if (update_prefers_class_a_polling(packets, last_tx_datarate)) {
+        printf("\r\n Pulling %d packets with class A polling at DR%d \r\n",
+               packets, last_tx_datarate);
+        is_fast_poll = 1;
+        fast_poll_idle = 0;
+        send_specific_message("ClassAPoll");
+    } else {
+        switch_to_class_c();
+    }
+}
 
-    // stores the status of a call to LoRaWAN protocol
-    lorawan_status_t retcode;
+/**
+ * Hands the data of one or more consecutive UpdateData fragments of a
+ * session, starting at the given fragment, to the blob transport
+ */
+static void store_fragment(uint8_t session, int fragment, const uint8_t *data, uint16_t size)
+{
+    uint64_t start = Kernel::Clock::now().time_since_epoch().count();
 
-    // Initialize LoRaWAN stack
-    if (lorawan.initialize(&ev_queue) != LORAWAN_STATUS_OK) {
-        printf("\r\n LoRa initialization failed! \r\n");
-        return -1;
+    if (blob_transport.store(session, fragment, data, size) != 0) {
+        printf("\r\n Failed to store packet %d of update session %d\r\n",
+               fragment + 1, session);
     }
 
-    printf("\r\n Mbed LoRaWANStack initialized \r\n");
+    fragment_latency_last = Kernel::Clock::now().time_since_epoch().count() - start;
+    if (fragment_latency_last > fragment_latency_max) {
+        fragment_latency_max = fragment_latency_last;
+    }
+    metric_observe(METRIC_FRAGMENT_LATENCY, fragment_latency_last);
+}
 
-    // prepare application callbacks
-    callbacks.events = mbed::callback(lora_event_handler);
-    lorawan.add_app_callbacks(&callbacks);
+/**
+ * Writes a run of fragments joined by fragment_batcher
+ */
+static void store_fragment_run(void *context, uint8_t session, int first,
+                               const uint8_t *data, uint16_t size)
+{
+    store_fragment(session, first, data, size);
+}
 
-    // Set number of retries in case of CONFIRMED messages
-    if (lorawan.set_confirmed_msg_retries(CONFIRMED_MSG_RETRY_COUNTER)
-            != LORAWAN_STATUS_OK) {
-        printf("\r\n set_confirmed_msg_retries failed! \r\n\r\n");
-        return -1;
+/**
+ * Number of received fragments waiting for the staging writer
+ */
+static uint8_t staging_queue_depth()
+{
+    uint8_t depth = 0;
+    for (uint8_t i = 0; i < rx_ring_count; i++) {
+        const char *msg = (const char *) rx_ring[(rx_ring_head + i) % RX_RING_SLOTS].data;
+        if (strncmp(msg, "UpdateData", 10) == 0) {
+            depth++;
+        }
     }
+    return depth;
+}
 
-    printf("\r\n [main]: CONFIRMED message retries : %d \r\n",
-           CONFIRMED_MSG_RETRY_COUNTER);
+/**
+ * Asks the server for a longer fragment interval when the staging writer
+ * falls behind, i.e. fragments pile up in the RX ring or writes have to
+ * wait for an erase, and for a shorter one once it keeps up again. The
+ * request goes out with the next uplink as FragInterval<ms>.
+ */
+static void update_flow_control(uint8_t queue_depth)
+{
+    uint32_t interval = fragment_interval;
+    uint32_t stalls = update_storage.erase_stalls();
 
-    // Enable adaptive data rate
-    if (lorawan.enable_adaptive_datarate() != LORAWAN_STATUS_OK) {
-        printf("\r\n enable_adaptive_datarate failed! \r\n");
-        return -1;
+    if (queue_depth >= FLOW_CONTROL_HIGH_WATER || stalls > flow_control_stalls) {
+        flow_control_calm = 0;
+        if (interval < FRAGMENT_INTERVAL_MAX) {
+            interval *= 2;
+        }
+    } else if (queue_depth <= 1 && ++flow_control_calm >= FLOW_CONTROL_CALM_FRAGMENTS) {
+        flow_control_calm = 0;
+        if (interval > FRAGMENT_INTERVAL_MIN) {
+            interval /= 2;
+        }
     }
+    flow_control_stalls = stalls;
 
-    printf("\r\n Adaptive data  rate (ADR) - Enabled \r\n");
-
-    retcode = lorawan.connect();
+    if (interval > FRAGMENT_INTERVAL_MAX) {
+        interval = FRAGMENT_INTERVAL_MAX;
+    } else if (interval < FRAGMENT_INTERVAL_MIN) {
+        interval = FRAGMENT_INTERVAL_MIN;
+    }
 
-    if (retcode == LORAWAN_STATUS_OK ||
-            retcode == LORAWAN_STATUS_CONNECT_IN_PROGRESS) {
-    } else {
-        printf("\r\n Connection error, code = %d \r\n", retcode);
-        return -1;
+    if (interval == fragment_interval) {
+        return;
     }
 
-    printf("\r\n Connection - In Progress ...\r\n");
+    fragment_interval = interval;
+    printf("\r\n Staging writer %s - requesting %lu ms between packets \r\n",
+           queue_depth > 1 ? "behind" : "idle", (unsigned long) interval);
 
-    // make your event queue dispatching events forever
-    ev_queue.dispatch_forever();
+    char message[sizeof(tx_buffer)];
+    snprintf(message, sizeof(message), "FragInterval%lu", (unsigned long) interval);
+    if (queue_uplink(message, strlen("FragInterval"))) {
+        schedule_required_uplink(0);
+    }
+}
 
-    return 0;
+/**
+ * Queues the fragments of a session still missing as
+ * Missing[/<session>:]<first>-<last>,... (1-based, truncated to one
+ * uplink) so the server resends them. A report is made after the last
+ * fragment of a round, or when no fragment arrived for a while, and the
+ * server sends the next round once it got it, so reports are queued
+ * rather than replaced.
+ */
+static void report_missing_fragments(uint8_t session)
+{
+    char message[sizeof(tx_buffer)];
+    size_t len = session == UPDATE_FIRMWARE_SESSION ? sprintf(message, "Missing")
+                 : sprintf(message, "Missing/%d:", session);
+    blob_transport.missing_ranges(session, message + len, sizeof(message) - len);
+
+    printf("\r\n %d of %d packets received - reporting %s \r\n",
+           blob_transport.received(session), blob_transport.fragments(session), message);
+    if (queue_uplink(message, 0)) {
+        schedule_required_uplink(0);
+    }
 }
 
-static void switch_to_class_c()
+/**
+ * Switches back to class A once every open session was received.
+ * After the last fragment of a round, reports the ones still missing.
+ */
+static void check_update_complete(uint8_t session, int last_fragment)
 {
-    printf("\r\n Switching to class C... \r\n");
-    int16_t retcode = lorawan.set_device_class(CLASS_C);
-    if (retcode == LORAWAN_STATUS_OK) {
-        printf("\r\n Switched to class C - Successful!\r\n");
+    fast_poll_idle = 0;
+    update_silent_rounds = 0;
+    arm_update_timeout();
+
+    if (blob_transport.check_complete(session)) {
+        if (blob_transport.open_sessions() == 0) {
+            printf("\r\n All update sessions complete - switching to Class A\r\n");
+            arm_update_timeout();
+            switch_to_class_a();
+        }
+    } else if (blob_transport.is_open(session)
+               && last_fragment == blob_transport.fragments(session) - 1) {
+        report_missing_fragments(session);
     }
-    blue_led = ON;
-    green_led = OFF;
-    is_class_c = 1;
-    send_specific_message("ClassCSwitch");
 }
 
-static void switch_to_class_a()
+static void report_all_missing_fragments()
 {
-    printf("\r\n Switching to class A... \r\n");
-    int16_t retcode = lorawan.set_device_class(CLASS_A);
-    if (retcode == LORAWAN_STATUS_OK) {
-        printf("\r\n switched to class A - Successful!\r\n");
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        if (blob_transport.is_open(i)) {
+            report_missing_fragments(i);
+        }
     }
-    blue_led = OFF;
-    green_led = ON;
-    is_class_c = 0;
-    send_specific_message("ClassAInit");
 }
 
 /**
- * Sends a message to the Network Server
+ * Called when no update packet arrived for UPDATE_RECEPTION_TIMEOUT
+ * fragment intervals in class C
  */
-static void send_message()
+static void update_reception_timeout()
 {
-    if (is_class_c)
+    update_timeout_event = 0;
+    if (++update_silent_rounds > UPDATE_SILENT_ROUNDS) {
+        abort_updates();
         return;
-    uint16_t packet_len;
-    int16_t retcode;
+    }
 
-    packet_len = sprintf((char *) tx_buffer, "DataFromEndDevice");
+    printf("\r\n No update packets for %lu ms \r\n",
+           (unsigned long)(UPDATE_RECEPTION_TIMEOUT * fragment_interval));
+    report_all_missing_fragments();
+    arm_update_timeout();
+}
 
-    retcode = lorawan.send(MBED_CONF_LORA_APP_PORT, tx_buffer, packet_len,
-                           MSG_UNCONFIRMED_FLAG);
+/**
+ * Restarts the reception timeout while sessions are open in class C.
+ * Fast polling counts its uplinks instead.
+ */
+static void arm_update_timeout()
+{
+    if (update_timeout_event) {
+        ev_queue.cancel(update_timeout_event);
+        update_timeout_event = 0;
+    }
+    if (blob_transport.open_sessions() == 0 || is_fast_poll) {
+        return;
+    }
 
-    if (retcode < 0) {
-        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
-        : printf("\r\n send() - Error code %d \r\n", retcode);
+    update_timeout_event = ev_queue.call_in(UPDATE_RECEPTION_TIMEOUT * fragment_interval,
+                                            update_reception_timeout);
+}
 
-        if (retcode == LORAWAN_STATUS_WOULD_BLOCK) {
-            //retry in 3 seconds
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 0) {
-                ev_queue.call_in(3000, send_message);
-            }
+/**
+ * Closes every update session and goes back to class A, when the server
+ * stopped sending
+ */
+static void abort_updates()
+{
+    printf("\r\n No update packets from the server - closing %d sessions \r\n",
+           blob_transport.open_sessions());
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        if (blob_transport.is_open(i)) {
+            blob_transport.close(i);
         }
-        return;
     }
-
-    printf("\r\n %d bytes scheduled for transmission \r\n", retcode);
-    memset(tx_buffer, 0, sizeof(tx_buffer));
-    printf(" With the message: DataFromEndDevice\r\n");
+    arm_update_timeout();
+    switch_to_class_a();
 }
 
 /**
- * Sends a specific message to the Network Server
+ * Bytes copied at a time by keep_unchanged_blocks(), whole fragments so
+ * each copy can be stored as such
  */
-static void send_specific_message(string message)
+#define KEEP_COPY_SIZE                  (MANIFEST_READ_SIZE < UPDATE_FRAGMENT_SIZE ? UPDATE_FRAGMENT_SIZE \
+                                         : MANIFEST_READ_SIZE / UPDATE_FRAGMENT_SIZE * UPDATE_FRAGMENT_SIZE)
+
+/**
+ * Handles KeepBlocks<dst>-<src>-<count>: the server found count manifest
+ * blocks, starting at block src of the running image, unchanged at byte
+ * offset dst of the new image, wherever its rolling checksum matched. They
+ * are copied from flash into the staging area instead of being sent. Only
+ * the fragments the run covers whole are kept; the server still sends the
+ * ones at its edges.
+ */
+static void keep_unchanged_blocks(const char *received_msg)
 {
-    if (is_class_c)
+    if (strncmp(received_msg, "KeepBlocks", 10) != 0) {
         return;
-    uint16_t packet_len;
-    int16_t retcode;
-
-    uint8_t n = message.length();
+    }
 
-    char string_arr[n + 1];
+    char *end;
+    long dst = strtol(received_msg + 10, &end, 10);
+    long src = *end == '-' ? strtol(end + 1, &end, 10) : -1;
+    long count = *end == '-' ? strtol(end + 1, &end, 10) : 0;
+    uint32_t old_size = running_image_size();
+    uint32_t new_size = blob_transport.fragments(UPDATE_FIRMWARE_SESSION) * UPDATE_FRAGMENT_SIZE;
+    if (dst < 0 || src < 0 || count <= 0
+            || (uint32_t) src * MANIFEST_BLOCK_SIZE >= old_size || (uint32_t) dst >= new_size) {
+        printf("\r\n Invalid KeepBlocks for the update \r\n");
+        return;
+    }
 
-    strcpy(string_arr, message.c_str());
+    uint32_t src_offset = (uint32_t) src * MANIFEST_BLOCK_SIZE;
+    uint32_t len = (uint32_t) count * MANIFEST_BLOCK_SIZE;
+    if (len > old_size - src_offset) {
+        len = old_size - src_offset;
+    }
+    if (len > new_size - dst) {
+        len = new_size - dst;
+    }
 
-    packet_len = sprintf((char *) tx_buffer, string_arr);
+    uint32_t first = (dst + UPDATE_FRAGMENT_SIZE - 1) / UPDATE_FRAGMENT_SIZE * UPDATE_FRAGMENT_SIZE;
+    uint32_t last = (dst + len) / UPDATE_FRAGMENT_SIZE * UPDATE_FRAGMENT_SIZE;
+    uint8_t buffer[KEEP_COPY_SIZE];
+
+    for (uint32_t offset = first; offset < last; offset += sizeof(buffer)) {
+        uint32_t size = last - offset < sizeof(buffer) ? last - offset : sizeof(buffer);
+        if (image_flash.read(buffer, MANIFEST_IMAGE_START + src_offset + (offset - dst), size) != 0
+                || blob_transport.store(UPDATE_FIRMWARE_SESSION, offset / UPDATE_FRAGMENT_SIZE,
+                                        buffer, size) != 0) {
+            printf("\r\n Failed to keep blocks %ld-%ld of the image \r\n", src, src + count - 1);
+            return;
+        }
+    }
 
-    retcode = lorawan.send(MBED_CONF_LORA_APP_PORT, tx_buffer, packet_len,
-                           MSG_UNCONFIRMED_FLAG);
+    printf("\r\n Kept blocks %ld-%ld at offset %ld - received %d of %d packets \r\n",
+           src, src + count - 1, dst, blob_transport.received(UPDATE_FIRMWARE_SESSION),
+           blob_transport.fragments(UPDATE_FIRMWARE_SESSION));
+    check_update_complete(UPDATE_FIRMWARE_SESSION, -1);
+}
 
-    if (retcode < 0) {
-        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("\r\n send - WOULD BLOCK\r\n")
-        : printf("\r\n send() - Error code %d \r\n", retcode);
+static void update_firmware_counter(char* received_msg, uint16_t len) {
+    int session;
+    int fragment;
+    const uint8_t *data;
+    uint16_t size;
 
-        ev_queue.call_in(3000, send_message);
+    if (BlobTransport::parse(received_msg, len, session, fragment, data, size)) {
+        printf("\r\n Packet Number: %d of update session %d\r\n", fragment + 1, session);
 
-        if (retcode == LORAWAN_STATUS_WOULD_BLOCK) {
-            //retry in 3 seconds
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 0) {
-                printf("\r\n Should send message now in class A \r\n");
-                ev_queue.call_in(3000, send_message);
-            }
+        int data_size = blob_transport.verify(session, fragment, data, size);
+        if (data_size < 0 && (session < 0 || session >= BLOB_MAX_SESSIONS)) {
+            return;
+        }
+        if (data_size >= 0) {
+            store_fragment(session, fragment, data, data_size);
+            printf("\r\n Packet stored in %lu ms (worst %lu ms, %lu erase stalls)\r\n",
+                   (unsigned long) fragment_latency_last, (unsigned long) fragment_latency_max,
+                   (unsigned long) update_storage.erase_stalls());
         }
-        return;
-    }
 
-    printf("\r\n %d bytes scheduled for transmission \r\n", retcode);
-    memset(tx_buffer, 0, sizeof(tx_buffer));
+        printf("\r\n Received %d of %d packets\r\n", blob_transport.received(session),
+               blob_transport.fragments(session));
+
+        update_flow_control(1);
+        check_update_complete(session, fragment);
+    }
 }
 
 /**
- * Receive a message from the Network Server
+ * Handles every UpdateData fragment waiting at the head of the RX ring in
+ * one go: consecutive fragments are written with a single program call,
+ * and progress is reported once for the whole batch.
  */
-static void receive_message()
+static void process_fragment_batch()
 {
-    receive_count++;
-    printf("\r\n Packets receive count: %d \r\n", receive_count);
-    uint8_t port;
-    int flags;
-    // retcode is also the number of bytes in the message ? :-P
-    int16_t retcode = lorawan.receive(rx_buffer, sizeof(rx_buffer), port, flags);
-
-    if (retcode == -1001) {
-        printf("\r\n LoRaMAC have nothing to read. Probably just an ACK \r\n");
-    } else if (retcode < 0) {
-        printf("\r\n receive() - Error code %d \r\n", retcode);
-        return;
-    }
+    uint64_t start = Kernel::Clock::now().time_since_epoch().count();
+    uint8_t batch = 0;
+    int last_fragment[BLOB_MAX_SESSIONS];
 
-    printf(" RX Data on port %u (%d bytes): ", port, retcode);
-    for (uint8_t i = 0; i < retcode; i++) {
-        printf("%02x ", rx_buffer[i]);
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        last_fragment[i] = -1;
     }
-    printf("\r\n");
 
-    auto received_msg = (char *) &rx_buffer;
-
-    printf("\r\n With message: %s \r\n", received_msg);
+    while (rx_ring_count) {
+        rx_slot_t *slot = &rx_ring[rx_ring_head];
+        int session;
+        int fragment;
+        const uint8_t *data;
+        uint16_t size;
 
-    if (strcmp(received_msg, "ClassCSwitch") == 0) {
-        printf("\r\n We should switch to class C if not already \r\n");
+        if (!BlobTransport::parse((const char *) slot->data, slot->len, session, fragment, data, size)) {
+            break;
+        }
 
-        switch_to_class_c();
-    }
+        int data_size = blob_transport.verify(session, fragment, data, size);
+        if (data_size >= 0) {
+            fragment_batcher.add(session, fragment, data, data_size);
+        }
 
-    if (strcmp(received_msg, "ClassASwitch") == 0) {
-        printf("\r\n We should switch to class A if not already \r\n");
+        if (session >= 0 && session < BLOB_MAX_SESSIONS) {
+            last_fragment[session] = fragment;
+        }
+        batch++;
 
-        switch_to_class_a();
+        rx_ring_head = (rx_ring_head + 1) % RX_RING_SLOTS;
+        rx_ring_count--;
     }
 
-    printf("\r\n");
-
-    check_if_update(received_msg);
-
-    update_firmware_counter(received_msg);
-    
-    memset(rx_buffer, 0, sizeof(rx_buffer));
-}
-
-static void print_rx_metadata()
-{
-    lorawan_rx_metadata metadata;
-    lorawan.get_rx_metadata(metadata);
+    fragment_batcher.flush();
 
-    printf("\r\n rssi: %d\r\n snr: %d\r\n time on air: %d\r\n datarate: %d\r\n channel: %d\r\n stale: %d\r\n",
-        metadata.rssi, metadata.snr, metadata.rx_toa, metadata.rx_datarate, metadata.channel, metadata.stale);
-}
+    uint32_t elapsed = Kernel::Clock::now().time_since_epoch().count() - start;
+    metric_inc(METRIC_BATCH_FRAGMENTS, batch);
+    metric_inc(METRIC_BATCH_TIME, elapsed);
+    uint32_t batch_time = metric_value(METRIC_BATCH_TIME);
 
-static void check_if_update(char* received_msg) {
-    char* substr = (char *)malloc(11);
-    strncpy(substr, received_msg, 11);
+    printf("\r\n Batch of %d packets handled in %lu ms (%lu packets/s), %d sessions open\r\n",
+           batch, (unsigned long) elapsed,
+           (unsigned long)(batch_time ? (uint32_t) metric_value(METRIC_BATCH_FRAGMENTS) * 1000 / batch_time : 0),
+           blob_transport.open_sessions());
 
-    if (strcmp(substr, "StartUpdate") == 0) {
-        printf(" Starting firmware update....\r\n");
-        char* update_size = (char *)malloc(11);
-        strncpy(update_size, received_msg+11, sizeof(received_msg));
-        printf("\r\n Packet Size of Update: %d\r\n", atoi(update_size));
-        update_packets = atoi(update_size);
-        free(update_size);
-    }
-
-    free(substr);
-}
-
-static void update_firmware_counter(char* received_msg) {
-    char* substr = (char *)malloc(11);
-    strncpy(substr, received_msg, 10);
-    substr[10] = '\0';
-    printf("%s", substr);
-    if (strcmp(substr, "UpdateData") == 0) {
-        char* update_number = (char *)malloc(sizeof(received_msg));
-        strncpy(update_number, received_msg+10, sizeof(received_msg));
-        printf("\r\n Packet Number: %d of the update\r\n", atoi(update_number) + 1);
-        update_count = update_count + atoi(update_number) + 1;
-        free(update_number);
-        
-        printf("\r\n Update counts is now: %d\r\n", update_count);
-
-        if (update_count == ((update_packets*(update_packets+1))/2)) {
-            update_count = 0;
-            printf("\r\n Update successful!! - switching to Class A\r\n");
-            switch_to_class_a();
+    update_flow_control(batch);
+    for (uint8_t i = 0; i < BLOB_MAX_SESSIONS; i++) {
+        if (last_fragment[i] >= 0) {
+            check_update_complete(i, last_fragment[i]);
         }
     }
-
-    free(substr);
 }
 
 /**
@@ -384,6 +2550,12 @@ static void lora_event_handler(lorawan_event_t event)
     switch (event) {
         case CONNECTED:
             printf("\r\n Connection - Successful \r\n");
+            lorawan_connected = 1;
+            crypto_heap_set_path(CRYPTO_PATH_DOWNLINK);
+            request_device_time();
+#if LOAD_GENERATOR
+            start_load_generator();
+#else
             if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
                 if (is_class_c == 1) {
                     send_specific_message("ClassCInit");
@@ -391,55 +2563,96 @@ static void lora_event_handler(lorawan_event_t event)
                     send_specific_message("ClassAInit");
                 }
             } else {
+                // build with LOAD_GENERATOR for periodic traffic
                 // ev_queue.call_every(TX_TIMER, send_message);
             }
-
+#endif
             break;
         case DISCONNECTED:
+            if (session_reset_pending) {
+                session_reset_pending = 0;
+                printf("\r\n Session closed - joining again \r\n");
+                lorawan_connected = 0;
+                rejoin();
+                break;
+            }
             ev_queue.break_dispatch();
             printf("\r\n Disconnected Successfully \r\n");
             break;
         case TX_DONE:
             printf("\r\n TX_DONE \r\n");
             printf("\r\n Message Sent to Network Server \r\n");
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 1) {
+            uplink_in_flight = 0;
+            set_idle_crypto_path();
+            tx_error_backoff = TX_ERROR_BACKOFF_MIN;
+            radio_health.on_tx_done();
+            record_tx_metadata();
+            uplink_fragment_done();
+            if (is_fast_poll && ++fast_poll_idle >= UPDATE_FAST_POLL_IDLE_LIMIT) {
+                abort_updates();
+            } else if (is_fast_poll && fast_poll_idle % UPDATE_RECEPTION_TIMEOUT == 0) {
+                report_all_missing_fragments();
+            }
+            if (!block_manifest.done()) {
+                queue_manifest();
+            }
+            if (uplink_queue_count) {
+                send_queued_uplink();
+            } else if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 1) {
                 //receive_message();
-            } else if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 0) {
+            } else if (is_fast_poll) {
+                // pull the next fragment as soon as duty cycle allows
+                schedule_required_uplink(0);
+            } else if (MBED_CONF_LORA_DUTY_CYCLE_ON && is_class_c == 0
+                       && !uplink_fragmenter.busy() && !LOAD_GENERATOR) {
                 send_message();
             }
+            if (uplink_required) {
+                schedule_required_uplink(0);
+            }
             break;
         case TX_TIMEOUT:
         case TX_ERROR:
         case TX_CRYPTO_ERROR:
         case TX_SCHEDULING_ERROR:
             printf("\r\n Transmission Error - EventCode = %d \r\n", event);
-            // try again
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
-                // send_message();
+            uplink_in_flight = 0;
+            set_idle_crypto_path();
+            handle_tx_error(event);
+            if (uplink_required) {
+                schedule_required_uplink(0);
             }
             break;
         case RX_DONE:
             printf("\r\n RX_DONE \r\n");
             printf("\r\n Received message from Network Server \r\n");
-            print_rx_metadata();       
+            radio_health.on_rx_done();
             receive_message();
+            start_history_backfill();
             break;
         case RX_TIMEOUT:
         case RX_ERROR:
             printf("\r\n Error in reception - Code = %d \r\n", event);
+            if (event == RX_ERROR) {
+                radio_health.on_error(event);
+            }
             break;
         case JOIN_FAILURE:
             printf("\r\n OTAA Failed - Check Keys \r\n");
             break;
         case UPLINK_REQUIRED:
             printf("\r\n Uplink required by NS \r\n");
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
-                // send_message();
-            }
+            // With automatic uplinks disabled the stack raises this for MAC
+            // command answers, confirmed class C downlinks and, after RX_DONE
+            // in class A, when the frame pending bit was set.
+            schedule_required_uplink(0);
             break;
         case CLASS_CHANGED:
             printf("class changed");
             break;
+        case DEVICE_TIME_SYNCHED:
+            device_time_synched();
+            break;
         default:
             MBED_ASSERT("Unknown Event");
     }
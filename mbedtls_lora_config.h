@@ -40,4 +40,14 @@
 #undef MBEDTLS_CHACHAPOLY_C
 #undef MBEDTLS_POLY1305_C
 
+// Allocate from a static buffer instead of the general heap when the
+// app.mbedtls-heap-size option is set, see crypto_heap.h. The debug
+// statistics measure the peak use to size the buffer.
+#if defined(MBED_CONF_APP_MBEDTLS_HEAP_SIZE) && MBED_CONF_APP_MBEDTLS_HEAP_SIZE > 0
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY
+#define MBEDTLS_MEMORY_BUFFER_ALLOC_C
+#define MBEDTLS_MEMORY_DEBUG
+#endif
+
 #endif /* MBEDTLS_LORA_CONFIG_H */
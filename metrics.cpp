@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+#include "checksum.h"
+
+typedef enum {
+    METRIC_TYPE_COUNTER,
+    METRIC_TYPE_GAUGE,
+    METRIC_TYPE_HISTOGRAM
+} metric_type_t;
+
+typedef struct {
+    const char *name;
+    uint8_t type;
+    uint8_t histogram;
+    uint32_t first_bound;
+} metric_descriptor_t;
+
+#define METRIC_COUNTER_DESCRIPTOR(id, name)     { name, METRIC_TYPE_COUNTER, 0, 0 },
+#define METRIC_GAUGE_DESCRIPTOR(id, name)       { name, METRIC_TYPE_GAUGE, 0, 0 },
+#define METRIC_HISTOGRAM_DESCRIPTOR(id, name, first_bound) \
+    { name, METRIC_TYPE_HISTOGRAM, METRIC_HISTOGRAM_##id, first_bound },
+
+static const metric_descriptor_t metric_table[METRIC_COUNT] = {
+    METRICS_LIST(METRIC_COUNTER_DESCRIPTOR, METRIC_GAUGE_DESCRIPTOR, METRIC_HISTOGRAM_DESCRIPTOR)
+};
+
+static uint32_t metric_values[METRIC_COUNT];
+
+static uint32_t metric_buckets[METRIC_HISTOGRAM_COUNT ? METRIC_HISTOGRAM_COUNT : 1]
+[METRIC_HISTOGRAM_BUCKETS];
+
+void metric_inc(metric_id_t id, uint32_t n)
+{
+    metric_values[id] += n;
+}
+
+void metric_inc_to(metric_id_t id, uint32_t total)
+{
+    if (total > metric_values[id]) {
+        metric_inc(id, total - metric_values[id]);
+    }
+}
+
+void metric_set(metric_id_t id, int32_t value)
+{
+    metric_values[id] = value;
+}
+
+void metric_max(metric_id_t id, int32_t value)
+{
+    if (value > (int32_t) metric_values[id]) {
+        metric_values[id] = value;
+    }
+}
+
+void metric_observe(metric_id_t id, uint32_t value)
+{
+    const metric_descriptor_t &metric = metric_table[id];
+    uint8_t bucket = 0;
+    while (bucket < METRIC_HISTOGRAM_BUCKETS - 1
+            && value >= (metric.first_bound << bucket)) {
+        bucket++;
+    }
+    metric_buckets[metric.histogram][bucket]++;
+    metric_values[id]++;
+}
+
+int32_t metric_value(metric_id_t id)
+{
+    return metric_values[id];
+}
+
+void metrics_print()
+{
+    printf("\r\n Metrics: \r\n");
+    for (uint8_t id = 0; id < METRIC_COUNT; id++) {
+        const metric_descriptor_t &metric = metric_table[id];
+        if (metric.type == METRIC_TYPE_GAUGE) {
+            printf(" %s: %ld\r\n", metric.name, (long)(int32_t) metric_values[id]);
+        } else if (metric.type == METRIC_TYPE_COUNTER) {
+            printf(" %s: %lu\r\n", metric.name, (unsigned long) metric_values[id]);
+        } else {
+            printf(" %s: %lu -", metric.name, (unsigned long) metric_values[id]);
+            for (uint8_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+                if (i < METRIC_HISTOGRAM_BUCKETS - 1) {
+                    printf(" <%lu:", (unsigned long)(metric.first_bound << i));
+                } else {
+                    printf(" more:");
+                }
+                printf("%lu", (unsigned long) metric_buckets[metric.histogram][i]);
+            }
+            printf("\r\n");
+        }
+    }
+}
+
+/**
+ * Hash of the names and types of the metrics, identifying the layout of
+ * the serialized report
+ */
+static uint16_t metrics_hash()
+{
+    uint16_t crc = CRC16_CCITT_INIT;
+    for (uint8_t id = 0; id < METRIC_COUNT; id++) {
+        const metric_descriptor_t &metric = metric_table[id];
+        crc = crc16_ccitt((const uint8_t *) metric.name, strlen(metric.name) + 1, crc);
+        crc = crc16_ccitt(&metric.type, 1, crc);
+    }
+    return crc;
+}
+
+static bool put_varint(uint8_t *buffer, uint16_t size, uint16_t &len, uint32_t value)
+{
+    do {
+        if (len >= size) {
+            return false;
+        }
+        buffer[len++] = (value & 0x7F) | (value >= 0x80 ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    return true;
+}
+
+uint16_t metrics_serialize(uint8_t *buffer, uint16_t size)
+{
+    if (size < 4) {
+        return 0;
+    }
+
+    uint16_t hash = metrics_hash();
+    buffer[0] = 'M';
+    buffer[1] = 'T';
+    buffer[2] = hash >> 8;
+    buffer[3] = hash;
+    uint16_t len = 4;
+
+    for (uint8_t id = 0; id < METRIC_COUNT; id++) {
+        const metric_descriptor_t &metric = metric_table[id];
+        uint32_t value = metric_values[id];
+        if (metric.type == METRIC_TYPE_GAUGE) {
+            value = (value << 1) ^ (uint32_t)((int32_t) value >> 31);
+        }
+
+        if (metric.type != METRIC_TYPE_HISTOGRAM) {
+            if (!put_varint(buffer, size, len, value)) {
+                return 0;
+            }
+            continue;
+        }
+
+        for (uint8_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+            if (!put_varint(buffer, size, len, metric_buckets[metric.histogram][i])) {
+                return 0;
+            }
+        }
+    }
+
+    return len;
+}
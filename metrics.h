@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_METRICS_H_
+#define APP_METRICS_H_
+
+#include <cstdint>
+#include "metrics_list.h"
+
+/**
+ * Buckets of a histogram: bucket i counts the values below
+ * first_bound << i, the last one all the others
+ */
+#define METRIC_HISTOGRAM_BUCKETS        8
+
+/*
+ * Registry of the metrics declared in metrics_list.h.
+ *
+ * The tables are built at compile time from the list: names and types in
+ * a const table, values in static arrays, so the registry takes no heap
+ * and a fixed amount of RAM. Every metric is read through the same
+ * serializers: metrics_print() for the UART and metrics_serialize() for a
+ * compact uplink.
+ */
+
+#define METRIC_ID(id, ...)              METRIC_##id,
+#define METRIC_HISTOGRAM_ID(id, ...)    METRIC_HISTOGRAM_##id,
+#define METRIC_NONE(...)
+
+typedef enum {
+    METRICS_LIST(METRIC_ID, METRIC_ID, METRIC_ID)
+    METRIC_COUNT
+} metric_id_t;
+
+typedef enum {
+    METRICS_LIST(METRIC_NONE, METRIC_NONE, METRIC_HISTOGRAM_ID)
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_id_t;
+
+/**
+ * Adds n to a counter
+ */
+void metric_inc(metric_id_t id, uint32_t n = 1);
+
+/**
+ * Adds to a counter what a running total kept by another module gained
+ * since the last call, so the counter never goes down
+ */
+void metric_inc_to(metric_id_t id, uint32_t total);
+
+/**
+ * Sets a gauge
+ */
+void metric_set(metric_id_t id, int32_t value);
+
+/**
+ * Raises a gauge to value if it is lower, for high-water marks
+ */
+void metric_max(metric_id_t id, int32_t value);
+
+/**
+ * Counts a value in a histogram
+ */
+void metric_observe(metric_id_t id, uint32_t value);
+
+/**
+ * Value of a counter or gauge, number of values of a histogram
+ */
+int32_t metric_value(metric_id_t id);
+
+/**
+ * Prints every metric, one per line
+ */
+void metrics_print();
+
+/**
+ * Writes every metric in list order, as
+ *     "MT" | hash of the list (16 bit BE) | values
+ * with counters and histogram buckets as unsigned LEB128 varints and
+ * gauges zigzag mapped first. Returns the bytes written, 0 if the buffer
+ * is too small.
+ */
+uint16_t metrics_serialize(uint8_t *buffer, uint16_t size);
+
+/**
+ * Largest output of metrics_serialize(), with every varint at its 5 byte
+ * maximum
+ */
+#define METRICS_REPORT_SIZE             (4 + 5 * (METRIC_COUNT - METRIC_HISTOGRAM_COUNT) \
+                                         + 5 * METRIC_HISTOGRAM_BUCKETS * METRIC_HISTOGRAM_COUNT)
+
+#endif /* APP_METRICS_H_ */
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_METRICS_LIST_H_
+#define APP_METRICS_LIST_H_
+
+/*
+ * Every metric of the application, by module, as
+ *     COUNTER(id, name)                       a count that only grows
+ *     GAUGE(id, name)                         a value that goes up and down
+ *     HISTOGRAM(id, name, first_bound)        a distribution, see metrics.h
+ * The registry in metrics.h expands this list into its tables, so adding
+ * a line here is all a module needs to do. Metrics are reported in this
+ * order; the report carries a hash of the list so the server can tell
+ * which build it comes from.
+ */
+#define METRICS_LIST(COUNTER, GAUGE, HISTOGRAM) \
+    /* uplinks */ \
+    COUNTER(TX_TIMEOUTS, "tx_timeouts") \
+    COUNTER(TX_ERRORS, "tx_errors") \
+    COUNTER(TX_CRYPTO_ERRORS, "tx_crypto") \
+    COUNTER(TX_SCHEDULING_ERRORS, "tx_scheduling") \
+    COUNTER(TX_REQUEUED, "requeued") \
+    COUNTER(TX_DROPPED, "dropped") \
+    COUNTER(SESSION_RESETS, "session_resets") \
+    GAUGE(UPLINK_LOSS, "uplink_loss") \
+    /* downlinks */ \
+    COUNTER(RX_RECEIVED, "rx_received") \
+    COUNTER(RX_OVERRUNS, "rx_overruns") \
+    GAUGE(RX_HIGH_WATER, "rx_high_water") \
+    /* updates */ \
+    COUNTER(BATCH_FRAGMENTS, "batch_packets") \
+    COUNTER(BATCH_TIME, "batch_ms") \
+    HISTOGRAM(FRAGMENT_LATENCY, "fragment_latency_ms", 2) \
+    /* telemetry */ \
+    GAUGE(TELEMETRY_RETAINED, "telemetry_retained") \
+    COUNTER(TELEMETRY_RETRANSMITTED, "telemetry_retransmitted") \
+    COUNTER(TELEMETRY_DROPPED, "telemetry_dropped") \
+    /* sensor */ \
+    COUNTER(SENSOR_CONVERSIONS, "sensor_conversions") \
+    COUNTER(SENSOR_DROPPED, "sensor_dropped") \
+    GAUGE(SENSOR_INTERVAL, "sensor_interval_ms") \
+    GAUGE(HISTORY_LOGGED, "history_logged") \
+    /* heap */ \
+    GAUGE(HEAP_USED, "heap_used") \
+    GAUGE(HEAP_PEAK, "heap_peak") \
+    GAUGE(HEAP_LIVE, "heap_live") \
+    COUNTER(HEAP_ALLOCATIONS, "heap_allocations") \
+    GAUGE(HEAP_FAILURES, "heap_failures") \
+    GAUGE(HEAP_LARGEST_FREE, "heap_largest_free") \
+    GAUGE(HEAP_LOWEST_LARGEST_FREE, "heap_lowest_largest_free") \
+    GAUGE(CRYPTO_HEAP_JOIN, "crypto_heap_join") \
+    GAUGE(CRYPTO_HEAP_UPLINK, "crypto_heap_uplink") \
+    GAUGE(CRYPTO_HEAP_DOWNLINK, "crypto_heap_downlink") \
+    GAUGE(CRYPTO_HEAP_FAILURES, "crypto_heap_failures") \
+    /* load generator */ \
+    COUNTER(LOAD_OFFERED, "load_offered") \
+    COUNTER(LOAD_SENT, "load_sent") \
+    COUNTER(LOAD_CONFIRMED, "load_confirmed") \
+    COUNTER(LOAD_REJECTED, "load_rejected") \
+    COUNTER(LOAD_BYTES, "load_bytes")
+
+#endif /* APP_METRICS_LIST_H_ */
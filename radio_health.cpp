@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "mbed.h"
+#include "radio_health.h"
+
+static uint64_t now_ms()
+{
+    return Kernel::Clock::now().time_since_epoch().count();
+}
+
+RadioHealthMonitor::RadioHealthMonitor(RecoverableRadio &radio)
+    : _radio(radio),
+      _tx_timeout_streak(0),
+      _rx_error_streak(0),
+      _transmit_time(0),
+      _tx_done_latency_last(0),
+      _tx_done_latency_max(0),
+      _tx_done_latency_total(0),
+      _tx_done_count(0),
+      _fault_time(0),
+      _reinits(0),
+      _recoveries(0),
+      _recovery_time_total(0),
+      _recovery_time_max(0)
+{
+    _radio.set_transmit_callback(mbed::callback(this, &RadioHealthMonitor::on_transmit));
+}
+
+void RadioHealthMonitor::on_transmit()
+{
+    _transmit_time = now_ms();
+}
+
+void RadioHealthMonitor::on_tx_done()
+{
+    if (_transmit_time) {
+        _tx_done_latency_last = now_ms() - _transmit_time;
+        _transmit_time = 0;
+        _tx_done_latency_total += _tx_done_latency_last;
+        _tx_done_count++;
+        if (_tx_done_latency_last > _tx_done_latency_max) {
+            _tx_done_latency_max = _tx_done_latency_last;
+        }
+
+        if (_tx_done_latency_last > RADIO_TX_DONE_LATENCY_LIMIT) {
+            printf("\r\n Radio slow - TX_DONE after %lu ms \r\n",
+                   (unsigned long) _tx_done_latency_last);
+            on_failure();
+            return;
+        }
+    }
+
+    _tx_timeout_streak = 0;
+    on_success();
+}
+
+void RadioHealthMonitor::on_rx_done()
+{
+    _rx_error_streak = 0;
+    on_success();
+}
+
+bool RadioHealthMonitor::on_error(lorawan_event_t event)
+{
+    on_failure();
+
+    if (event == TX_TIMEOUT) {
+        _transmit_time = 0;
+        if (++_tx_timeout_streak < RADIO_TX_TIMEOUT_STREAK_LIMIT) {
+            return false;
+        }
+    } else {
+        if (++_rx_error_streak < RADIO_RX_ERROR_STREAK_LIMIT) {
+            return false;
+        }
+    }
+
+    printf("\r\n Radio wedged (%d TX timeouts, %d RX errors in a row) - reinitializing \r\n",
+           _tx_timeout_streak, _rx_error_streak);
+    reinitialize();
+    return true;
+}
+
+void RadioHealthMonitor::print_stats()
+{
+    printf("\r\n Radio TX_DONE latency - last: %lu ms max: %lu ms mean: %lu ms\r\n",
+           (unsigned long) _tx_done_latency_last,
+           (unsigned long) _tx_done_latency_max,
+           (unsigned long)(_tx_done_count ? _tx_done_latency_total / _tx_done_count : 0));
+    printf(" Radio reinits: %d recoveries: %d MTTR: %lu ms max: %lu ms\r\n",
+           _reinits, _recoveries,
+           (unsigned long)(_recoveries ? _recovery_time_total / _recoveries : 0),
+           (unsigned long) _recovery_time_max);
+}
+
+void RadioHealthMonitor::on_failure()
+{
+    if (_fault_time == 0) {
+        _fault_time = now_ms();
+    }
+}
+
+void RadioHealthMonitor::on_success()
+{
+    if (_fault_time == 0) {
+        return;
+    }
+
+    uint32_t recovery_time = now_ms() - _fault_time;
+    _fault_time = 0;
+    _recoveries++;
+    _recovery_time_total += recovery_time;
+    if (recovery_time > _recovery_time_max) {
+        _recovery_time_max = recovery_time;
+    }
+
+    printf("\r\n Radio recovered after %lu ms \r\n", (unsigned long) recovery_time);
+    print_stats();
+}
+
+void RadioHealthMonitor::reinitialize()
+{
+    _radio.reinitialize();
+    _reinits++;
+    _tx_timeout_streak = 0;
+    _rx_error_streak = 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_RADIO_HEALTH_H_
+#define APP_RADIO_HEALTH_H_
+
+#include <cstdint>
+#include "lorawan/system/lorawan_data_structures.h"
+#include "RecoverableRadio.h"
+
+/**
+ * Consecutive TX_TIMEOUT events after which the radio is reinitialized
+ */
+#ifndef RADIO_TX_TIMEOUT_STREAK_LIMIT
+#define RADIO_TX_TIMEOUT_STREAK_LIMIT   3
+#endif
+
+/**
+ * Consecutive RX_ERROR events after which the radio is reinitialized.
+ * Higher than the TX limit as noise alone produces the odd CRC error.
+ */
+#ifndef RADIO_RX_ERROR_STREAK_LIMIT
+#define RADIO_RX_ERROR_STREAK_LIMIT     5
+#endif
+
+/**
+ * Latency from the last transmission of an uplink to TX_DONE above which
+ * the radio counts as misbehaving, in ms. Covers time on air at DR0 plus
+ * both RX windows.
+ */
+#ifndef RADIO_TX_DONE_LATENCY_LIMIT
+#define RADIO_TX_DONE_LATENCY_LIMIT     10000
+#endif
+
+/*
+ * Tracks radio error streaks and TX_DONE latency, and reinitializes the
+ * radio when it looks wedged (SPI glitch, SX126X busy line stuck).
+ *
+ * The latency runs from the moment the radio last started transmitting,
+ * so duty cycle deferral and the retransmissions of a confirmed uplink,
+ * which can take much longer than a healthy exchange, are not counted.
+ *
+ * Recovery time is measured from the first error of a streak to the next
+ * successful TX_DONE or RX_DONE.
+ */
+class RadioHealthMonitor {
+public:
+    RadioHealthMonitor(RecoverableRadio &radio);
+
+    void on_tx_done();
+
+    void on_rx_done();
+
+    /**
+     * To be called on TX_TIMEOUT and RX_ERROR.
+     * Returns true if the radio was reinitialized.
+     */
+    bool on_error(lorawan_event_t event);
+
+    void print_stats();
+
+private:
+    void on_transmit();
+    void on_failure();
+    void on_success();
+    void reinitialize();
+
+    RecoverableRadio &_radio;
+
+    uint8_t _tx_timeout_streak;
+    uint8_t _rx_error_streak;
+
+    uint64_t _transmit_time;
+    uint32_t _tx_done_latency_last;
+    uint32_t _tx_done_latency_max;
+    uint64_t _tx_done_latency_total;
+    uint32_t _tx_done_count;
+
+    uint64_t _fault_time;
+    uint16_t _reinits;
+    uint16_t _recoveries;
+    uint64_t _recovery_time_total;
+    uint32_t _recovery_time_max;
+};
+
+#endif /* APP_RADIO_HEALTH_H_ */
@@ -0,0 +1,258 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "sample_codec.h"
+
+/**
+ * Residuals summed for the Rice parameter before the sums are halved,
+ * so it follows changes in the signal
+ */
+#define SAMPLE_RICE_WINDOW              16
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+SamplePredictor::SamplePredictor(uint8_t order)
+    : _order(order > SAMPLE_PREDICTOR_ADAPTIVE ? SAMPLE_PREDICTOR_ADAPTIVE : order)
+{
+    reset();
+}
+
+void SamplePredictor::reset()
+{
+    _history_length = 0;
+    memset(_history, 0, sizeof(_history));
+    memset(_order_error, 0, sizeof(_order_error));
+    _residual_sum = 4;
+    _residual_count = 1;
+}
+
+int32_t SamplePredictor::predict() const
+{
+    uint8_t order = _order;
+    if (order == SAMPLE_PREDICTOR_ADAPTIVE) {
+        order = 0;
+        for (uint8_t i = 1; i < 3; i++) {
+            if (_order_error[i] < _order_error[order]) {
+                order = i;
+            }
+        }
+    }
+    return predict(order);
+}
+
+int32_t SamplePredictor::predict(uint8_t order) const
+{
+    // fall back to a lower order until there is enough history
+    if (order > _history_length - 1) {
+        order = _history_length - 1;
+    }
+    switch (order) {
+        case 2:
+            return 3 * _history[0] - 3 * _history[1] + _history[2];
+        case 1:
+            return 2 * _history[0] - _history[1];
+        default:
+            return _history[0];
+    }
+}
+
+uint8_t SamplePredictor::rice_parameter() const
+{
+    uint8_t k = 0;
+    while (k < 31 && ((uint32_t) _residual_count << k) < _residual_sum) {
+        k++;
+    }
+    return k;
+}
+
+void SamplePredictor::update(int32_t sample, uint32_t mapped_residual)
+{
+    if (_order == SAMPLE_PREDICTOR_ADAPTIVE && _history_length) {
+        // decaying sum of the errors each order would have made
+        for (uint8_t i = 0; i < 3; i++) {
+            int32_t error = sample - predict(i);
+            _order_error[i] += (error < 0 ? -error : error) - _order_error[i] / 8;
+        }
+    }
+
+    _history[2] = _history[1];
+    _history[1] = _history[0];
+    _history[0] = sample;
+
+    if (_history_length) {
+        _residual_sum += mapped_residual;
+        if (++_residual_count == SAMPLE_RICE_WINDOW) {
+            _residual_sum /= 2;
+            _residual_count /= 2;
+        }
+    }
+
+    if (_history_length < 3) {
+        _history_length++;
+    }
+}
+
+SampleEncoder::SampleEncoder(uint8_t order)
+    : _predictor(order),
+      _buffer(NULL),
+      _capacity(0),
+      _bit(0),
+      _samples(0)
+{
+}
+
+void SampleEncoder::begin(uint8_t *buffer, uint16_t size)
+{
+    _predictor.reset();
+    _buffer = buffer;
+    _capacity = (uint32_t) size * 8;
+    _bit = 0;
+    _samples = 0;
+    memset(_buffer, 0, size);
+}
+
+bool SampleEncoder::add(int32_t sample)
+{
+    if (_buffer == NULL) {
+        return false;
+    }
+
+    SamplePredictor saved = _predictor;
+    uint32_t saved_bit = _bit;
+    uint32_t mapped = 0;
+    bool fits;
+
+    if (_predictor.keyframe()) {
+        fits = put((uint32_t) sample, 32);
+    } else {
+        mapped = zigzag(sample - _predictor.predict());
+        uint8_t k = _predictor.rice_parameter();
+        uint32_t quotient = mapped >> k;
+        if (quotient < SAMPLE_RICE_ESCAPE) {
+            fits = put(1, quotient + 1) && put(mapped, k);
+        } else {
+            fits = put(0, SAMPLE_RICE_ESCAPE) && put(mapped, 32);
+        }
+    }
+
+    if (!fits) {
+        // clear the bits already written
+        for (uint32_t bit = saved_bit; bit < _bit; bit++) {
+            _buffer[bit / 8] &= ~(0x80 >> (bit % 8));
+        }
+        _bit = saved_bit;
+        _predictor = saved;
+        return false;
+    }
+
+    _predictor.update(sample, mapped);
+    _samples++;
+    return true;
+}
+
+bool SampleEncoder::put(uint32_t value, uint8_t bits)
+{
+    if (_bit + bits > _capacity) {
+        return false;
+    }
+
+    while (bits--) {
+        if ((value >> bits) & 1) {
+            _buffer[_bit / 8] |= 0x80 >> (_bit % 8);
+        }
+        _bit++;
+    }
+    return true;
+}
+
+SampleDecoder::SampleDecoder(uint8_t order)
+    : _predictor(order),
+      _buffer(NULL),
+      _capacity(0),
+      _bit(0)
+{
+}
+
+void SampleDecoder::begin(const uint8_t *buffer, uint16_t size)
+{
+    _predictor.reset();
+    _buffer = buffer;
+    _capacity = (uint32_t) size * 8;
+    _bit = 0;
+}
+
+bool SampleDecoder::next(int32_t &sample)
+{
+    uint32_t value;
+
+    if (_predictor.keyframe()) {
+        if (!get(value, 32)) {
+            return false;
+        }
+        sample = (int32_t) value;
+        _predictor.update(sample, 0);
+        return true;
+    }
+
+    uint32_t quotient = 0;
+    uint32_t bit;
+    do {
+        if (!get(bit, 1)) {
+            return false;
+        }
+    } while (bit == 0 && ++quotient < SAMPLE_RICE_ESCAPE);
+
+    uint32_t mapped;
+    if (quotient == SAMPLE_RICE_ESCAPE) {
+        if (!get(mapped, 32)) {
+            return false;
+        }
+    } else {
+        uint8_t k = _predictor.rice_parameter();
+        if (!get(value, k)) {
+            return false;
+        }
+        mapped = (quotient << k) | value;
+    }
+
+    sample = _predictor.predict() + unzigzag(mapped);
+    _predictor.update(sample, mapped);
+    return true;
+}
+
+bool SampleDecoder::get(uint32_t &value, uint8_t bits)
+{
+    if (_bit + bits > _capacity) {
+        return false;
+    }
+
+    value = 0;
+    while (bits--) {
+        value = (value << 1) | ((_buffer[_bit / 8] >> (7 - _bit % 8)) & 1);
+        _bit++;
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_SAMPLE_CODEC_H_
+#define APP_SAMPLE_CODEC_H_
+
+#include <cstdint>
+
+/*
+ * Predictive compression of slowly varying sensor readings.
+ *
+ * Encoder and decoder run the same predictor over the samples sent so
+ * far and only the residual, the sample minus its prediction, is coded:
+ *     order 0: previous sample (plain delta coding)
+ *     order 1: linear extrapolation of the last two samples
+ *     order 2: second order extrapolation of the last three samples
+ *     adaptive: whichever of the above predicted the recent samples best
+ * Residuals are zigzag mapped and Rice coded with a parameter adapted to
+ * the mean residual, identically on both sides.
+ *
+ * Every block starts with a keyframe, the raw 32 bit sample, so each
+ * block, i.e. each uplink, decodes on its own and a lost one does not
+ * desynchronize the predictor of the following ones.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+
+/**
+ * Predictor order selecting the adaptive predictor
+ */
+#define SAMPLE_PREDICTOR_ADAPTIVE       3
+
+/**
+ * Predictor order, see above
+ */
+#ifndef SAMPLE_PREDICTOR_ORDER
+#define SAMPLE_PREDICTOR_ORDER          SAMPLE_PREDICTOR_ADAPTIVE
+#endif
+
+/**
+ * Unary quotients from this length on escape to a raw 32 bit residual
+ */
+#define SAMPLE_RICE_ESCAPE              16
+
+/**
+ * Predictor and Rice parameter state, kept in lockstep by the encoder
+ * and the decoder
+ */
+class SamplePredictor {
+public:
+    SamplePredictor(uint8_t order);
+
+    /**
+     * Forgets the history, so the next sample is a keyframe
+     */
+    void reset();
+
+    bool keyframe() const
+    {
+        return _history_length == 0;
+    };
+
+    int32_t predict() const;
+
+    uint8_t rice_parameter() const;
+
+    /**
+     * Moves the history on with the sample just coded
+     */
+    void update(int32_t sample, uint32_t mapped_residual);
+
+private:
+    uint8_t _order;
+    int32_t predict(uint8_t order) const;
+
+    uint8_t _history_length;
+    uint32_t _order_error[3];
+    int32_t _history[3];
+    uint32_t _residual_sum;
+    uint16_t _residual_count;
+};
+
+class SampleEncoder {
+public:
+    SampleEncoder(uint8_t order = SAMPLE_PREDICTOR_ORDER);
+
+    /**
+     * Starts a block in the given buffer, beginning with a keyframe
+     */
+    void begin(uint8_t *buffer, uint16_t size);
+
+    /**
+     * Appends a sample to the block. Returns false, leaving the block
+     * unchanged, if it does not fit.
+     */
+    bool add(int32_t sample);
+
+    uint16_t samples() const
+    {
+        return _samples;
+    };
+
+    uint32_t bits() const
+    {
+        return _bit;
+    };
+
+    /**
+     * Bytes of the block, the last one zero padded
+     */
+    uint16_t bytes() const
+    {
+        return (_bit + 7) / 8;
+    };
+
+private:
+    bool put(uint32_t value, uint8_t bits);
+
+    SamplePredictor _predictor;
+    uint8_t *_buffer;
+    uint32_t _capacity;
+    uint32_t _bit;
+    uint16_t _samples;
+};
+
+class SampleDecoder {
+public:
+    SampleDecoder(uint8_t order = SAMPLE_PREDICTOR_ORDER);
+
+    void begin(const uint8_t *buffer, uint16_t size);
+
+    /**
+     * Decodes the next sample. Returns false at the end of the block:
+     * unary quotients are zeros ended by a one, so the zero padding never
+     * decodes as a sample.
+     */
+    bool next(int32_t &sample);
+
+private:
+    bool get(uint32_t &value, uint8_t bits);
+
+    SamplePredictor _predictor;
+    const uint8_t *_buffer;
+    uint32_t _capacity;
+    uint32_t _bit;
+};
+
+#endif /* APP_SAMPLE_CODEC_H_ */
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sampling_profiler.h"
+
+SamplingProfiler::SamplingProfiler()
+    : _running(false),
+      _interval_us(PROFILER_INTERVAL_US)
+{
+    reset();
+}
+
+void SamplingProfiler::start(uint32_t interval_us)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _interval_us = interval_us;
+    _running = true;
+    _ticker.attach(mbed::callback(this, &SamplingProfiler::sample),
+                   std::chrono::microseconds(interval_us));
+#else
+    printf("\r\n Sampling profiler needs the RTOS \r\n");
+#endif
+}
+
+void SamplingProfiler::stop()
+{
+    _ticker.detach();
+    _running = false;
+}
+
+void SamplingProfiler::reset()
+{
+    memset(_slots, 0, sizeof(_slots));
+    _samples = 0;
+    _interrupts = 0;
+    _dropped = 0;
+}
+
+void SamplingProfiler::dump()
+{
+    bool running = _running;
+    stop();
+
+    printf("\r\n Profile: %lu samples every %lu us, %lu in interrupts, %lu dropped \r\n",
+           (unsigned long) _samples, (unsigned long) _interval_us,
+           (unsigned long) _interrupts, (unsigned long) _dropped);
+    for (uint16_t i = 0; i < PROFILER_SLOTS; i++) {
+        if (_slots[i].count) {
+            printf(" PC 0x%08lx %lu\r\n", (unsigned long) _slots[i].pc,
+                   (unsigned long) _slots[i].count);
+        }
+    }
+
+    if (running) {
+        start(_interval_us);
+    }
+}
+
+void SamplingProfiler::sample()
+{
+    _samples++;
+
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+    // another exception was preempted: the process stack does not hold its PC
+    if (!(SCB->ICSR & SCB_ICSR_RETTOBASE_Msk)) {
+        _interrupts++;
+        return;
+    }
+#endif
+
+    // exception frame: r0, r1, r2, r3, r12, lr, pc, xpsr
+    const uint32_t *frame = (const uint32_t *)(uintptr_t) __get_PSP();
+    record(frame[6]);
+}
+
+void SamplingProfiler::record(uint32_t pc)
+{
+    // Fibonacci hashing: the top bits of the product mix every address bit
+    uint32_t slot = (uint32_t)(pc * 2654435761u) >> (32 - PROFILER_SLOT_BITS);
+    for (uint8_t probe = 0; probe < PROFILER_MAX_PROBES; probe++) {
+        slot_t &entry = _slots[(slot + probe) % PROFILER_SLOTS];
+        if (entry.count == 0) {
+            entry.pc = pc;
+        }
+        if (entry.pc == pc) {
+            entry.count++;
+            return;
+        }
+    }
+    _dropped++;
+}
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_SAMPLING_PROFILER_H_
+#define APP_SAMPLING_PROFILER_H_
+
+#include <cstdint>
+#include "mbed.h"
+
+/**
+ * When set, the application samples the program counter from a timer
+ * interrupt and prints the histogram on the serial port periodically.
+ */
+#ifndef SAMPLING_PROFILER
+#define SAMPLING_PROFILER               0
+#endif
+
+/**
+ * Distinct program counters the histogram holds, as a power of two for
+ * the hash. Samples at other addresses once it is full are counted as
+ * dropped.
+ */
+#ifndef PROFILER_SLOT_BITS
+#define PROFILER_SLOT_BITS              7
+#endif
+
+#define PROFILER_SLOTS                  (1 << PROFILER_SLOT_BITS)
+
+/**
+ * Sampling period, in us. Not a multiple of the 1 ms RTOS tick so the
+ * samples do not lock onto periodic work.
+ */
+#ifndef PROFILER_INTERVAL_US
+#define PROFILER_INTERVAL_US            997
+#endif
+
+/**
+ * Slots probed for a program counter before the sample is dropped
+ */
+#define PROFILER_MAX_PROBES             8
+
+/*
+ * Statistical profiler: a Ticker interrupt reads the program counter
+ * the interrupted thread stacked on its process stack and counts it in a
+ * fixed-size hash table, so the time spent anywhere, the LoRaWAN stack
+ * and mbedtls included, shows up in proportion to the samples.
+ *
+ * Samples taken while another interrupt was running are only counted,
+ * their program counter is not on the process stack. Cortex-M0/M0+ cannot
+ * tell them apart, so they are counted at the interrupted thread's address.
+ * Requires the RTOS, for threads to run on the process stack.
+ *
+ * dump() prints one "PC <address> <count>" line per address, for
+ * tools/profile_symbolizer.cpp to map to functions in the ELF file.
+ */
+class SamplingProfiler {
+public:
+    SamplingProfiler();
+
+    void start(uint32_t interval_us = PROFILER_INTERVAL_US);
+
+    void stop();
+
+    /**
+     * Clears the histogram
+     */
+    void reset();
+
+    /**
+     * Prints the histogram, pausing the sampling meanwhile
+     */
+    void dump();
+
+private:
+    void sample();
+
+    void record(uint32_t pc);
+
+    typedef struct {
+        uint32_t pc;
+        uint32_t count;
+    } slot_t;
+
+    Ticker _ticker;
+    bool _running;
+    uint32_t _interval_us;
+    slot_t _slots[PROFILER_SLOTS];
+    volatile uint32_t _samples;
+    volatile uint32_t _interrupts;
+    volatile uint32_t _dropped;
+};
+
+#endif /* APP_SAMPLING_PROFILER_H_ */
@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include "timestamp_codec.h"
+
+static uint16_t varint_size(uint32_t value)
+{
+    uint16_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+TimestampEncoder::TimestampEncoder()
+    : _buffer(NULL),
+      _size(0),
+      _len(0),
+      _offset(0),
+      _last(0),
+      _delta(0),
+      _repeat(0),
+      _count(0)
+{
+}
+
+void TimestampEncoder::begin(uint8_t *buffer, uint16_t size, uint32_t offset)
+{
+    _buffer = buffer;
+    _size = size;
+    _len = 0;
+    _offset = offset;
+    _repeat = 0;
+    _count = 0;
+}
+
+uint16_t TimestampEncoder::pending_size(uint32_t delta, uint16_t repeat) const
+{
+    if (repeat == 0) {
+        return 0;
+    }
+    uint16_t size = varint_size(delta << 1);
+    return repeat == 1 ? size : size + varint_size(repeat);
+}
+
+bool TimestampEncoder::add(uint32_t time)
+{
+    if (_buffer == NULL) {
+        return false;
+    }
+
+    if (_count == 0) {
+        if (_size < 4) {
+            return false;
+        }
+        uint32_t first = time + _offset;
+        _buffer[0] = first >> 24;
+        _buffer[1] = first >> 16;
+        _buffer[2] = first >> 8;
+        _buffer[3] = first;
+        _len = 4;
+        _last = time;
+        _count = 1;
+        return true;
+    }
+
+    uint32_t delta = time < _last ? 0 : time - _last;
+    if (delta > TIMESTAMP_MAX_DELTA) {
+        delta = TIMESTAMP_MAX_DELTA;
+    }
+    if (_repeat && delta == _delta && _repeat < UINT16_MAX) {
+        // extend the run
+        if (_len + pending_size(_delta, _repeat + 1) > _size) {
+            return false;
+        }
+        _repeat++;
+    } else {
+        if (_len + pending_size(_delta, _repeat) + pending_size(delta, 1) > _size) {
+            return false;
+        }
+        finish();
+        _delta = delta;
+        _repeat = 1;
+    }
+
+    _last = time;
+    _count++;
+    return true;
+}
+
+uint16_t TimestampEncoder::finish()
+{
+    if (_repeat == 1) {
+        put_varint(_delta << 1);
+    } else if (_repeat > 1) {
+        put_varint(_delta << 1 | 1);
+        put_varint(_repeat);
+    }
+    _repeat = 0;
+    return _len;
+}
+
+void TimestampEncoder::put_varint(uint32_t value)
+{
+    while (value >= 0x80) {
+        _buffer[_len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    _buffer[_len++] = value;
+}
+
+TimestampDecoder::TimestampDecoder()
+    : _buffer(NULL),
+      _size(0),
+      _pos(0),
+      _started(false),
+      _time(0),
+      _delta(0),
+      _repeat(0)
+{
+}
+
+void TimestampDecoder::begin(const uint8_t *buffer, uint16_t size)
+{
+    _buffer = buffer;
+    _size = size;
+    _pos = 0;
+    _started = false;
+    _repeat = 0;
+}
+
+bool TimestampDecoder::next(uint32_t &time)
+{
+    if (!_started) {
+        if (_buffer == NULL || _size < 4) {
+            return false;
+        }
+        _time = (uint32_t) _buffer[0] << 24 | (uint32_t) _buffer[1] << 16
+                | (uint32_t) _buffer[2] << 8 | _buffer[3];
+        _pos = 4;
+        _started = true;
+        time = _time;
+        return true;
+    }
+
+    if (_repeat == 0) {
+        uint32_t entry;
+        if (!get_varint(entry)) {
+            return false;
+        }
+        _delta = entry >> 1;
+        _repeat = 1;
+        if ((entry & 1) && !get_varint(_repeat)) {
+            return false;
+        }
+        if (_repeat == 0) {
+            return false;
+        }
+    }
+
+    _repeat--;
+    _time += _delta;
+    time = _time;
+    return true;
+}
+
+bool TimestampDecoder::get_varint(uint32_t &value)
+{
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (_pos >= _size) {
+            return false;
+        }
+        uint8_t byte = _buffer[_pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_TIMESTAMP_CODEC_H_
+#define APP_TIMESTAMP_CODEC_H_
+
+#include <cstdint>
+
+/**
+ * Largest difference between two times, larger ones are clamped
+ */
+#define TIMESTAMP_MAX_DELTA             0x7FFFFFFF
+
+/**
+ * Largest encoding of one time: a varint of up to 32 bits
+ */
+#define TIMESTAMP_MAX_ENTRY_SIZE        5
+
+/*
+ * Compact timestamps for a series of readings.
+ *
+ * The first time is sent in full, 32 bit big endian, shifted by an offset
+ * so a device clock counting from boot can be reported in network time.
+ * Each following time is the difference from the previous one, as an
+ * unsigned LEB128 varint of:
+ *     delta << 1          for a single difference
+ *     delta << 1 | 1      followed by a varint n, for n times the same
+ *                         difference, i.e. a run at a fixed period
+ * A run of fixed period readings thus costs a few bytes whatever its
+ * length, and irregular readings one or two bytes each.
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+class TimestampEncoder {
+public:
+    TimestampEncoder();
+
+    /**
+     * Starts a series in the given buffer. offset is added to the first
+     * time; the differences are left unchanged.
+     */
+    void begin(uint8_t *buffer, uint16_t size, uint32_t offset);
+
+    /**
+     * Appends a time, not earlier than the previous one. Returns false,
+     * leaving the series unchanged, if it does not fit.
+     */
+    bool add(uint32_t time);
+
+    /**
+     * Writes the pending run and returns the bytes of the series
+     */
+    uint16_t finish();
+
+    uint16_t count() const
+    {
+        return _count;
+    };
+
+private:
+    uint16_t pending_size(uint32_t delta, uint16_t repeat) const;
+
+    void put_varint(uint32_t value);
+
+    uint8_t *_buffer;
+    uint16_t _size;
+    uint16_t _len;
+    uint32_t _offset;
+    uint32_t _last;
+    uint32_t _delta;
+    uint16_t _repeat;
+    uint16_t _count;
+};
+
+class TimestampDecoder {
+public:
+    TimestampDecoder();
+
+    void begin(const uint8_t *buffer, uint16_t size);
+
+    /**
+     * Decodes the next time. Returns false at the end of the series.
+     */
+    bool next(uint32_t &time);
+
+private:
+    bool get_varint(uint32_t &value);
+
+    const uint8_t *_buffer;
+    uint16_t _size;
+    uint16_t _pos;
+    bool _started;
+    uint32_t _time;
+    uint32_t _delta;
+    uint32_t _repeat;
+};
+
+#endif /* APP_TIMESTAMP_CODEC_H_ */
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares fixed rate sampling with the AdaptiveSampler of
+ * adaptive_sampler.h on a simulated room temperature: two days of daily
+ * variation with a window opened every few hours. For each policy it
+ * reports the DS1820 conversions, the energy they take, the telemetry
+ * records needed to send the readings compressed with sample_codec.h,
+ * and the mean and largest error of the temperature rebuilt by linear
+ * interpolation between readings.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/adaptive_sampling_simulation.cpp adaptive_sampler.cpp sample_codec.cpp -o adaptive_sampling_simulation
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "adaptive_sampler.h"
+#include "sample_codec.h"
+#include "uplink_retention.h"
+
+/**
+ * DS18B20 conversion: 750 ms at 1.5 mA and 3.3 V, in mJ
+ */
+#define CONVERSION_ENERGY               (0.75 * 1.5 * 3.3)
+
+#define SIMULATED_SECONDS               (2 * 24 * 3600)
+
+typedef struct {
+    const char *name;
+    uint32_t min_interval;
+    uint32_t max_interval;
+} policy_t;
+
+/**
+ * The temperature every second, in 1/16 degree as read from a DS18B20
+ */
+static std::vector<int32_t> room_temperature()
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0, 0.02);
+    std::vector<int32_t> trace;
+
+    for (int second = 0; second < SIMULATED_SECONDS; second++) {
+        double celsius = 21 + 2 * sin(2 * M_PI * second / (24 * 3600));
+        // a window is opened for a minute about every 4 hours, then
+        // the room warms up again
+        int since_open = (second + 3600) % (4 * 3600 + 7 * 60 + 13);
+        if (since_open < 60) {
+            celsius -= 4.0 * since_open / 60;
+        } else {
+            celsius -= 4.0 * exp(-(since_open - 60) / 900.0);
+        }
+        trace.push_back(lround((celsius + noise(rng)) * 16));
+    }
+    return trace;
+}
+
+static void simulate(const policy_t &policy, const std::vector<int32_t> &trace)
+{
+    AdaptiveSampler sampler(policy.min_interval * 1000, policy.max_interval * 1000, 2);
+    std::vector<uint32_t> times;
+
+    for (uint32_t second = 0; second < trace.size();
+            second += sampler.update(trace[second]) / 1000) {
+        times.push_back(second);
+    }
+
+    uint8_t block[UPLINK_RETENTION_RECORD_SIZE];
+    SampleEncoder encoder;
+    unsigned records = 1;
+    encoder.begin(block, sizeof(block));
+    for (uint32_t time : times) {
+        if (!encoder.add(trace[time])) {
+            records++;
+            encoder.begin(block, sizeof(block));
+            encoder.add(trace[time]);
+        }
+    }
+
+    double max_error = 0;
+    double error_sum = 0;
+    for (size_t i = 1; i < times.size(); i++) {
+        for (uint32_t t = times[i - 1]; t < times[i]; t++) {
+            double estimate = trace[times[i - 1]] + (double)(trace[times[i]] - trace[times[i - 1]])
+                              * (t - times[i - 1]) / (times[i] - times[i - 1]);
+            double error = fabs(estimate - trace[t]) / 16;
+            max_error = error > max_error ? error : max_error;
+            error_sum += error;
+        }
+    }
+
+    printf("%-22s %11zu %10.0f %8u %10.3f %10.2f\n", policy.name, times.size(),
+           times.size() * CONVERSION_ENERGY, records, error_sum / times.back(), max_error);
+}
+
+int main()
+{
+    const policy_t policies[] = {
+        { "fixed 10 s", 10, 10 },
+        { "fixed 60 s", 60, 60 },
+        { "fixed 300 s", 300, 300 },
+        { "adaptive 10 s - 60 s", 10, 60 },
+        { "adaptive 10 s - 300 s", 10, 300 },
+    };
+
+    std::vector<int32_t> trace = room_temperature();
+
+    printf("%d hours, threshold 1/8 degree\n\n", SIMULATED_SECONDS / 3600);
+    printf("%-22s %11s %10s %8s %10s %10s\n", "policy", "conversions", "energy mJ",
+           "records", "mean err C", "max err C");
+    for (const policy_t &policy : policies) {
+        simulate(policy, trace);
+    }
+
+    return 0;
+}
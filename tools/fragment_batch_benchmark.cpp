@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how many update fragments per second the device code can take
+ * when each one is written on its own, as on a single RX_DONE, and when
+ * the fragments waiting in the RX ring are joined by FragmentBatcher.
+ * Every fragment has its CRC-16 checked, as BlobTransport::verify() does,
+ * and is written to a RAM image. Each write call can be given a fixed
+ * cost, to stand for the setup of a flash program operation.
+ *
+ * Build with:
+ *     g++ -std=c++11 -O2 -I. tools/fragment_batch_benchmark.cpp fragment_batcher.cpp checksum.cpp -o fragment_batch_benchmark
+ * and run with the cost of a write call in us (default 0) and the number
+ * of 255 fragment sessions to receive (default 2000).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "checksum.h"
+#include "fragment_batcher.h"
+
+#define FRAGMENT_SIZE                   32
+#define FRAGMENTS                       255
+
+typedef std::chrono::steady_clock clock_type;
+
+static uint8_t image[FRAGMENTS * FRAGMENT_SIZE];
+
+static unsigned write_cost_us = 0;
+
+static void write_image(void *context, uint8_t session, int first, const uint8_t *data,
+                        uint16_t size)
+{
+    memcpy(image + first * FRAGMENT_SIZE, data, size);
+    if (write_cost_us) {
+        clock_type::time_point end = clock_type::now() + std::chrono::microseconds(write_cost_us);
+        while (clock_type::now() < end) {
+        }
+    }
+}
+
+/**
+ * Checks the CRC of a fragment the way BlobTransport::verify() does and
+ * returns its data size, or -1
+ */
+static int verify(int fragment, const uint8_t *data, uint16_t size)
+{
+    uint8_t number[2] = { (uint8_t)(fragment >> 8), (uint8_t) fragment };
+    uint16_t crc = crc16_ccitt(number, sizeof(number), CRC16_CCITT_INIT);
+    crc = crc16_ccitt(data, size - 2, crc);
+    if (data[size - 2] != (crc >> 8) || data[size - 1] != (crc & 0xFF)) {
+        return -1;
+    }
+    return size - 2;
+}
+
+int main(int argc, char **argv)
+{
+    write_cost_us = argc > 1 ? atoi(argv[1]) : 0;
+    unsigned sessions = argc > 2 ? atoi(argv[2]) : 2000;
+
+    std::vector<uint8_t> fragments(FRAGMENTS * (FRAGMENT_SIZE + 2));
+    for (int i = 0; i < FRAGMENTS; i++) {
+        uint8_t *data = &fragments[i * (FRAGMENT_SIZE + 2)];
+        for (int j = 0; j < FRAGMENT_SIZE; j++) {
+            data[j] = rand();
+        }
+        uint8_t number[2] = { (uint8_t)(i >> 8), (uint8_t) i };
+        uint16_t crc = crc16_ccitt(number, sizeof(number), CRC16_CCITT_INIT);
+        crc = crc16_ccitt(data, FRAGMENT_SIZE, crc);
+        data[FRAGMENT_SIZE] = crc >> 8;
+        data[FRAGMENT_SIZE + 1] = crc;
+    }
+
+    printf("%u sessions of %d fragments, %u us per write call\n\n", sessions, FRAGMENTS,
+           write_cost_us);
+    printf("batch  writes/session  fragments/s\n");
+
+    const unsigned batches[] = { 1, 2, 4, 8 };
+    for (unsigned batch : batches) {
+        std::vector<uint8_t> buffer(batch * FRAGMENT_SIZE);
+        FragmentBatcher batcher(buffer.data(), buffer.size(), FRAGMENT_SIZE, write_image, NULL);
+
+        clock_type::time_point start = clock_type::now();
+        for (unsigned session = 0; session < sessions; session++) {
+            for (int i = 0; i < FRAGMENTS; i++) {
+                const uint8_t *data = &fragments[i * (FRAGMENT_SIZE + 2)];
+                int size = verify(i, data, FRAGMENT_SIZE + 2);
+                if (size < 0) {
+                    printf("CRC error\n");
+                    return 1;
+                }
+                if (batch == 1) {
+                    // single RX_DONE path: one write per fragment
+                    write_image(NULL, 0, i, data, size);
+                    continue;
+                }
+                batcher.add(0, i, data, size);
+                if ((i + 1) % batch == 0) {
+                    batcher.flush();
+                }
+            }
+            batcher.flush();
+        }
+        double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        unsigned writes = batch == 1 ? FRAGMENTS : batcher.writes() / sessions;
+        printf("%5u  %14u  %11.0f\n", batch, writes, sessions * FRAGMENTS / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays the traffic of many devices running the load generator, with
+ * the profile of load_generator.h, and reports the load the network
+ * server and the gateways would see: frames per second on average and at
+ * the busiest second, confirmed frames, payload bytes, and the share of
+ * the airtime used on each of the 3 default EU868 channels. Frames that
+ * overlap another one on the same channel and data rate are counted as
+ * collisions.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/load_generator_simulation.cpp load_generator.cpp update_planner.cpp -o load_generator_simulation
+ * and run with the number of devices (default 100), the duration in
+ * hours (default 1) and the data rate (default 5). With a fourth argument
+ * "trace" it prints one "time_ms,device,size,confirmed" line per frame
+ * instead, to drive a network server test harness.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "load_generator.h"
+#include "update_planner.h"
+
+/**
+ * PHY payload added to a frame by LoRaWAN: MHDR, FHDR, FPort and MIC
+ */
+#define PHY_OVERHEAD                    13
+
+#define CHANNELS                        3
+
+typedef struct {
+    uint64_t start;
+    uint32_t air;
+    uint32_t device;
+    uint8_t size;
+    uint8_t channel;
+    bool confirmed;
+} frame_t;
+
+static const load_size_t sizes[] = { LOAD_PAYLOAD_SIZES };
+
+static const load_profile_t profile = {
+    LOAD_INTERVAL,
+    LOAD_BURST_INTERVAL,
+    LOAD_BURSTINESS,
+    LOAD_CONFIRMED,
+    sizes,
+    sizeof(sizes) / sizeof(sizes[0])
+};
+
+int main(int argc, char **argv)
+{
+    unsigned devices = argc > 1 ? atoi(argv[1]) : 100;
+    double hours = argc > 2 ? atof(argv[2]) : 1;
+    uint8_t datarate = argc > 3 ? atoi(argv[3]) : 5;
+    bool trace = argc > 4 && strcmp(argv[4], "trace") == 0;
+    uint64_t duration = (uint64_t)(hours * 3600 * 1000);
+
+    std::vector<frame_t> frames;
+    for (unsigned device = 0; device < devices; device++) {
+        LoadGenerator generator(profile, device + 1);
+        uint32_t channel = device * 2654435761UL;
+        // the devices joined at different times
+        uint64_t time = channel % LOAD_INTERVAL;
+        while (true) {
+            load_frame_t frame;
+            generator.next(frame);
+            time += frame.delay;
+            if (time >= duration) {
+                break;
+            }
+            // the stack hops pseudo-randomly between the enabled channels
+            channel = channel * 1103515245 + 12345;
+            frames.push_back({ time, lora_time_on_air(datarate, frame.size + PHY_OVERHEAD),
+                               device, frame.size, (uint8_t)((channel >> 16) % CHANNELS),
+                               frame.confirmed });
+        }
+    }
+
+    std::sort(frames.begin(), frames.end(), [](const frame_t &a, const frame_t &b) {
+        return a.start < b.start;
+    });
+
+    if (trace) {
+        for (const frame_t &frame : frames) {
+            printf("%llu,%u,%u,%d\n", (unsigned long long) frame.start, frame.device,
+                   frame.size, frame.confirmed);
+        }
+        return 0;
+    }
+
+    uint64_t confirmed = 0;
+    uint64_t bytes = 0;
+    uint64_t air[CHANNELS] = { 0 };
+    uint64_t collided = 0;
+    uint64_t busiest = 0;
+    size_t window = 0;
+    // end of the latest frame on each channel, and the frame it belongs to
+    uint64_t channel_end[CHANNELS] = { 0 };
+    size_t channel_last[CHANNELS];
+    std::vector<bool> collides(frames.size(), false);
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        const frame_t &frame = frames[i];
+        confirmed += frame.confirmed;
+        bytes += frame.size;
+        air[frame.channel] += frame.air;
+
+        while (frames[window].start + 1000 <= frame.start) {
+            window++;
+        }
+        busiest = std::max<uint64_t>(busiest, i - window + 1);
+
+        if (channel_end[frame.channel] > frame.start) {
+            collides[i] = true;
+            collides[channel_last[frame.channel]] = true;
+        }
+        if (frame.start + frame.air > channel_end[frame.channel]) {
+            channel_end[frame.channel] = frame.start + frame.air;
+            channel_last[frame.channel] = i;
+        }
+    }
+    for (size_t i = 0; i < frames.size(); i++) {
+        collided += collides[i];
+    }
+
+    double seconds = duration / 1000.0;
+    printf("%u devices for %.1f h at DR%d: one frame every %lu ms, %u/1000 in bursts, "
+           "%u/1000 confirmed\n\n", devices, hours, datarate, (unsigned long) LOAD_INTERVAL,
+           LOAD_BURSTINESS, LOAD_CONFIRMED);
+    printf("frames          %llu\n", (unsigned long long) frames.size());
+    printf("frames/s        %.2f (busiest second %llu)\n", frames.size() / seconds,
+           (unsigned long long) busiest);
+    printf("confirmed       %llu\n", (unsigned long long) confirmed);
+    printf("payload bytes/s %.1f\n", bytes / seconds);
+    for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+        printf("channel %d busy  %.1f%%\n", channel, 100.0 * air[channel] / duration);
+    }
+    printf("collided        %.1f%%\n", frames.empty() ? 0 : 100.0 * collided / frames.size());
+    return 0;
+}
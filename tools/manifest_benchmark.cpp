@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the time block_signature() takes to build the delta update
+ * manifest of an image, scaled to 256 KB, as the device prints it once
+ * its manifest is complete. The image is read from RAM through the same
+ * MANIFEST_READ_SIZE buffer the device streams flash through, so only
+ * the hashing is timed.
+ *
+ * Build with:
+ *     g++ -std=c++11 -O2 -I. tools/manifest_benchmark.cpp block_signature.cpp checksum.cpp -lmbedcrypto -o manifest_benchmark
+ * adding -DMANIFEST_READ_SIZE=<n> to try another read buffer, and run
+ * with the image size in KB (default 256) and the number of passes
+ * (default 20).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "block_signature.h"
+
+typedef std::chrono::steady_clock clock_type;
+
+static int read_image(void *context, void *buffer, uint32_t addr, uint32_t size)
+{
+    const std::vector<uint8_t> &image = *static_cast<std::vector<uint8_t> *>(context);
+    if (addr + size > image.size()) {
+        return -1;
+    }
+    memcpy(buffer, &image[addr], size);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t image_kb = argc > 1 ? atoi(argv[1]) : 256;
+    unsigned passes = argc > 2 ? atoi(argv[2]) : 20;
+
+    std::vector<uint8_t> image(image_kb * 1024);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = rand();
+    }
+    uint32_t blocks = (image.size() + MANIFEST_BLOCK_SIZE - 1) / MANIFEST_BLOCK_SIZE;
+
+    printf("%u KB image, %u blocks of %d bytes, read %d bytes at a time, %u passes\n\n",
+           image_kb, blocks, MANIFEST_BLOCK_SIZE, MANIFEST_READ_SIZE, passes);
+
+    uint32_t check = 0;
+    clock_type::time_point start = clock_type::now();
+    for (unsigned pass = 0; pass < passes; pass++) {
+        for (uint32_t block = 0; block < blocks; block++) {
+            uint32_t offset = block * MANIFEST_BLOCK_SIZE;
+            uint32_t size = image.size() - offset < MANIFEST_BLOCK_SIZE
+                            ? image.size() - offset : MANIFEST_BLOCK_SIZE;
+            block_signature_t signature;
+            if (block_signature(read_image, &image, offset, size, signature) != 0) {
+                printf("read error\n");
+                return 1;
+            }
+            check += signature.weak + signature.strong[0];
+        }
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    double ms_per_256k = seconds * 1000 / passes * 256 / image_kb;
+    printf("%.2f ms per 256 KB (%.1f MB/s), manifest of %u bytes (check %08x)\n",
+           ms_per_256k, passes * image.size() / seconds / 1e6,
+           blocks * MANIFEST_SIGNATURE_SIZE, check);
+    return 0;
+}
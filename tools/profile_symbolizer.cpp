@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Maps the "PC <address> <count>" lines printed by the SamplingProfiler
+ * to the functions of the application ELF file, and lists the functions
+ * by share of the samples. Every profile in the serial log is added up.
+ *
+ * The symbols are read with arm-none-eabi-nm, or the nm given in the NM
+ * environment variable.
+ *
+ * Build with:
+ *     g++ -std=c++11 tools/profile_symbolizer.cpp -o profile_symbolizer
+ * and run with:
+ *     ./profile_symbolizer BUILD/mbed-os-example-lorawan.elf < serial.log
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef struct {
+    unsigned long address;
+    unsigned long size;
+    std::string name;
+} symbol_t;
+
+static bool load_symbols(const char *elf, std::vector<symbol_t> &symbols)
+{
+    const char *nm = getenv("NM") ? getenv("NM") : "arm-none-eabi-nm";
+    std::string command = std::string(nm) + " -n -S -C --defined-only '" + elf + "'";
+    FILE *pipe = popen(command.c_str(), "r");
+    if (pipe == NULL) {
+        return false;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), pipe)) {
+        unsigned long address;
+        unsigned long size = 0;
+        char type;
+        int name_at = 0;
+        // "address size type name", the size is missing for some symbols
+        if (sscanf(line, "%lx %lx %c %n", &address, &size, &type, &name_at) < 3 || name_at == 0) {
+            size = 0;
+            name_at = 0;
+            if (sscanf(line, "%lx %c %n", &address, &type, &name_at) < 2 || name_at == 0) {
+                continue;
+            }
+        }
+        if (type != 't' && type != 'T' && type != 'w' && type != 'W') {
+            continue;
+        }
+
+        std::string name(line + name_at);
+        name.erase(name.find_last_not_of("\r\n") + 1);
+        // Thumb function addresses have bit 0 set
+        symbols.push_back({ address & ~1UL, size, name });
+    }
+
+    pclose(pipe);
+    std::sort(symbols.begin(), symbols.end(), [](const symbol_t &a, const symbol_t &b) {
+        return a.address < b.address;
+    });
+    return !symbols.empty();
+}
+
+static std::string symbolize(const std::vector<symbol_t> &symbols, unsigned long pc)
+{
+    auto after = std::upper_bound(symbols.begin(), symbols.end(), pc,
+    [](unsigned long value, const symbol_t &symbol) {
+        return value < symbol.address;
+    });
+    if (after == symbols.begin()) {
+        return "??";
+    }
+
+    const symbol_t &symbol = *(after - 1);
+    if (symbol.size && pc >= symbol.address + symbol.size) {
+        return "??";
+    }
+    return symbol.name;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <elf file> < serial.log\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<symbol_t> symbols;
+    if (!load_symbols(argv[1], symbols)) {
+        fprintf(stderr, "Cannot read the symbols of %s\n", argv[1]);
+        return 1;
+    }
+
+    std::map<std::string, unsigned long> functions;
+    unsigned long total = 0;
+    unsigned long interrupts = 0;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        unsigned long pc;
+        unsigned long count;
+        unsigned long samples;
+        unsigned long interval;
+        unsigned long in_interrupts;
+        if (sscanf(line.c_str(), " PC 0x%lx %lu", &pc, &count) == 2) {
+            functions[symbolize(symbols, pc)] += count;
+            total += count;
+        } else if (sscanf(line.c_str(), " Profile: %lu samples every %lu us, %lu in interrupts",
+                          &samples, &interval, &in_interrupts) == 3) {
+            interrupts += in_interrupts;
+        }
+    }
+
+    if (total == 0) {
+        fprintf(stderr, "No profile in the input\n");
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, unsigned long>> sorted(functions.begin(), functions.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, unsigned long> &a,
+    const std::pair<std::string, unsigned long> &b) {
+        return a.second > b.second;
+    });
+
+    printf("%lu samples in threads, %lu in interrupts\n\n", total, interrupts);
+    for (const auto &function : sorted) {
+        printf("%6.2f%% %8lu  %s\n", 100.0 * function.second / total, function.second,
+               function.first.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the bits per sample of the predictors of sample_codec.h on
+ * sensor traces, packed in blocks of one telemetry record as the device
+ * sends them. Order 0 is plain delta coding. Every block is decoded
+ * again to check the round trip.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/sample_compression_benchmark.cpp sample_codec.cpp -o sample_compression_benchmark
+ * and run with trace files holding one integer sample per line, e.g. raw
+ * DS18B20 readings in 1/16 degree. Without files it runs on synthetic
+ * traces.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sample_codec.h"
+#include "uplink_retention.h"
+
+typedef struct {
+    std::string name;
+    std::vector<int32_t> samples;
+} trace_t;
+
+static bool load_trace(const char *path, trace_t &trace)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    trace.name = path;
+    long value;
+    while (fscanf(file, "%ld", &value) == 1) {
+        trace.samples.push_back(value);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Two days of room temperature sampled every minute, in 1/16 degree
+ */
+static trace_t diurnal_trace(std::mt19937 &rng)
+{
+    std::normal_distribution<double> noise(0, 0.03);
+    trace_t trace = { "synthetic diurnal", {} };
+    for (int minute = 0; minute < 2 * 24 * 60; minute++) {
+        double celsius = 21 + 3 * sin(2 * M_PI * minute / (24 * 60)) + noise(rng);
+        trace.samples.push_back(lround(celsius * 16));
+    }
+    return trace;
+}
+
+/**
+ * A thermostat cycling a heater: linear heating and cooling slopes
+ */
+static trace_t thermostat_trace(std::mt19937 &rng)
+{
+    std::normal_distribution<double> noise(0, 0.03);
+    trace_t trace = { "synthetic thermostat", {} };
+    double celsius = 19;
+    bool heating = true;
+    for (int minute = 0; minute < 2 * 24 * 60; minute++) {
+        celsius += heating ? 0.05 : -0.02;
+        if (celsius > 21) {
+            heating = false;
+        } else if (celsius < 19) {
+            heating = true;
+        }
+        trace.samples.push_back(lround((celsius + noise(rng)) * 16));
+    }
+    return trace;
+}
+
+/**
+ * The readings of the DS1820 stub in DummySensor.h
+ */
+static trace_t dummy_sensor_trace()
+{
+    trace_t trace = { "DummySensor", {} };
+    for (int i = 0; i < 2 * 24 * 60; i++) {
+        trace.samples.push_back(3 + 2 * i);
+    }
+    return trace;
+}
+
+/**
+ * Returns the bits per sample, blocks included, or -1 if a block does
+ * not decode to the samples it was built from
+ */
+static double bits_per_sample(const trace_t &trace, uint8_t order, uint16_t block_size)
+{
+    std::vector<uint8_t> block(block_size);
+    SampleEncoder encoder(order);
+    SampleDecoder decoder(order);
+    uint32_t bits = 0;
+    size_t first = 0;
+
+    while (first < trace.samples.size()) {
+        encoder.begin(block.data(), block_size);
+        size_t end = first;
+        while (end < trace.samples.size() && encoder.add(trace.samples[end])) {
+            end++;
+        }
+        if (end == first) {
+            return -1;
+        }
+        bits += encoder.bytes() * 8;
+
+        decoder.begin(block.data(), encoder.bytes());
+        int32_t sample;
+        size_t i = first;
+        while (decoder.next(sample)) {
+            if (i == end || sample != trace.samples[i]) {
+                return -1;
+            }
+            i++;
+        }
+        if (i != end) {
+            return -1;
+        }
+        first = end;
+    }
+
+    return (double) bits / trace.samples.size();
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<trace_t> traces;
+    for (int i = 1; i < argc; i++) {
+        trace_t trace;
+        if (!load_trace(argv[i], trace) || trace.samples.empty()) {
+            fprintf(stderr, "Cannot read samples from %s\n", argv[i]);
+            return 1;
+        }
+        traces.push_back(trace);
+    }
+
+    if (traces.empty()) {
+        std::mt19937 rng(1);
+        traces.push_back(diurnal_trace(rng));
+        traces.push_back(thermostat_trace(rng));
+        traces.push_back(dummy_sensor_trace());
+    }
+
+    printf("Bits per sample in blocks of %d bytes\n\n", UPLINK_RETENTION_RECORD_SIZE);
+    printf("%-24s %8s %8s %8s %8s %8s\n", "trace", "samples", "delta", "linear",
+           "order 2", "adaptive");
+
+    for (const trace_t &trace : traces) {
+        printf("%-24s %8zu", trace.name.c_str(), trace.samples.size());
+        for (uint8_t order = 0; order <= SAMPLE_PREDICTOR_ADAPTIVE; order++) {
+            double bits = bits_per_sample(trace, order, UPLINK_RETENTION_RECORD_SIZE);
+            if (bits < 0) {
+                printf("  round trip failed\n");
+                return 1;
+            }
+            printf(" %8.2f", bits);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
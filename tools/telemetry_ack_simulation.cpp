@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulates acknowledged telemetry (uplink_retention.h) over a link losing
+ * uplinks and downlinks at random, and counts the downlinks it takes
+ * against confirmed uplinks, where every uplink the server receives is
+ * answered and a record is sent up to CONFIRMED_TRIALS times.
+ *
+ * Each reading interval the device sends the records reported missing,
+ * then one new record holding the readings taken since the last one. The
+ * server answers with an Ack after every <ack every> new records, and
+ * after a record it already had. Without holding, new records are added
+ * even when every slot waits for an Ack, dropping the oldest; with
+ * holding, the device keeps the readings and sends the oldest record
+ * again instead, as send_message() does. The sensor block is taken to
+ * hold any number of readings; on the device, those that do not fit go
+ * to the history log.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/telemetry_ack_simulation.cpp uplink_retention.cpp -o telemetry_ack_simulation
+ * and run with the number of reading intervals per loss rate (default
+ * 100000).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "uplink_retention.h"
+
+/**
+ * Transmissions of a confirmed uplink before it is given up
+ */
+#define CONFIRMED_TRIALS                8
+
+static std::mt19937 rng(1);
+static std::uniform_int_distribution<int> permille(0, 999);
+
+typedef struct {
+    unsigned readings;
+    unsigned delivered;
+    unsigned uplinks;
+    unsigned downlinks;
+} result_t;
+
+static result_t simulate_confirmed(unsigned steps, int loss)
+{
+    result_t result = {};
+    for (unsigned step = 0; step < steps; step++) {
+        result.readings++;
+        bool delivered = false;
+        for (int trial = 0; trial < CONFIRMED_TRIALS; trial++) {
+            result.uplinks++;
+            if (permille(rng) < loss) {
+                continue;
+            }
+            delivered = true;
+            result.downlinks++;
+            if (permille(rng) >= loss) {
+                break;
+            }
+        }
+        result.delivered += delivered;
+    }
+    return result;
+}
+
+static result_t simulate_acked(unsigned steps, int loss, unsigned ack_every, bool hold)
+{
+    UplinkRetention retention;
+    // indexed by sequence number unwrapped past 16 bits
+    std::vector<unsigned> readings_of(steps + 1);
+    std::vector<bool> received(steps + 1);
+    unsigned next_seq = 0;
+    result_t result = {};
+    unsigned pending = 0;
+    unsigned since_ack = 0;
+    int newest = -1;
+    uint8_t frame[UPLINK_RETENTION_HEADER_SIZE + UPLINK_RETENTION_RECORD_SIZE];
+    uint8_t record[1] = { 0 };
+
+    for (unsigned step = 0; step < steps; step++) {
+        result.readings++;
+        pending++;
+        bool new_reading = true;
+
+        for (;;) {
+            uint8_t len = retention.next_gap(frame);
+            if (len == 0 && hold && retention.full()) {
+                if (!new_reading) {
+                    break;
+                }
+                len = retention.resend_oldest(frame);
+            } else if (len == 0) {
+                if (pending == 0) {
+                    break;
+                }
+                len = retention.add(record, sizeof(record), frame);
+                readings_of[next_seq++] = pending;
+                pending = 0;
+            }
+            new_reading = false;
+
+            uint16_t wrapped = (frame[0] << 8) | frame[1];
+            unsigned seq = next_seq - (uint16_t)(next_seq - wrapped);
+            result.uplinks++;
+            if (permille(rng) < loss) {
+                continue;
+            }
+
+            bool duplicate = received[seq];
+            if (!duplicate) {
+                received[seq] = true;
+                result.delivered += readings_of[seq];
+                newest = (int) seq > newest ? seq : newest;
+                since_ack++;
+            }
+            if (!duplicate && since_ack < ack_every) {
+                continue;
+            }
+
+            since_ack = 0;
+            result.downlinks++;
+            if (permille(rng) < loss) {
+                continue;
+            }
+            unsigned base = newest >= UPLINK_RETENTION_ACK_WINDOW - 1
+                            ? newest - (UPLINK_RETENTION_ACK_WINDOW - 1) : 0;
+            uint32_t bitmap = 0;
+            for (unsigned i = 0; i < UPLINK_RETENTION_ACK_WINDOW && base + i <= (unsigned) newest; i++) {
+                bitmap |= (uint32_t) received[base + i] << i;
+            }
+            uint16_t acked;
+            uint16_t missing;
+            retention.ack(base, bitmap, acked, missing);
+        }
+    }
+    return result;
+}
+
+static void print_result(const result_t &result)
+{
+    printf("  %9.1f  %6.2f%%",
+           100.0 * result.downlinks / result.readings,
+           100.0 * (result.readings - result.delivered) / result.readings);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned steps = argc > 1 ? atoi(argv[1]) : 100000;
+    const int losses[] = { 10, 50, 100, 200 };
+    const unsigned cadences[] = { 8, 16, 32 };
+
+    printf("%u readings per loss rate, %d retention slots\n", steps, UPLINK_RETENTION_SLOTS);
+    printf("downlinks per 100 readings and readings never delivered\n\n");
+    printf(" loss  ack every      confirmed         acked          acked, held\n");
+
+    for (int loss : losses) {
+        for (unsigned ack_every : cadences) {
+            printf("%4d%%  %9u", loss / 10, ack_every);
+            print_result(simulate_confirmed(steps, loss));
+            print_result(simulate_acked(steps, loss, ack_every, false));
+            print_result(simulate_acked(steps, loss, ack_every, true));
+            printf("\n");
+        }
+    }
+    return 0;
+}
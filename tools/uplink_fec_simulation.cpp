@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulates the delivery of fragmented uplinks over a link losing frames
+ * at random, with and without the parity frames of uplink_fec.h, using
+ * the group size the device would pick for each loss rate.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/uplink_fec_simulation.cpp uplink_fec.cpp -o uplink_fec_simulation
+ * and run with the number of data frames per transfer (default 40, about
+ * 1 KB) and of transfers per loss rate (default 100000).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "uplink_fec.h"
+
+int main(int argc, char **argv)
+{
+    unsigned frames = argc > 1 ? atoi(argv[1]) : 40;
+    unsigned transfers = argc > 2 ? atoi(argv[2]) : 100000;
+    const uint16_t losses[] = { 5, 10, 20, 50, 100, 200 };
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> permille(0, 999);
+
+    printf("%u data frames per transfer, %u transfers per loss rate\n\n", frames, transfers);
+    printf(" loss  group  overhead  delivered plain  delivered with parity\n");
+
+    for (uint16_t loss : losses) {
+        uint8_t group = uplink_fec_group_size(loss);
+        unsigned plain = 0;
+        unsigned protected_ = 0;
+
+        for (unsigned t = 0; t < transfers; t++) {
+            bool plain_ok = true;
+            bool parity_ok = true;
+
+            for (unsigned first = 0; first < frames; first += group) {
+                unsigned members = frames - first < group ? frames - first : group;
+                unsigned lost_data = 0;
+                for (unsigned i = 0; i < members; i++) {
+                    lost_data += permille(rng) < loss;
+                }
+                unsigned lost_parity = permille(rng) < loss;
+
+                plain_ok &= lost_data == 0;
+                // one loss per group, data or parity, is recoverable
+                parity_ok &= lost_data == 0 || lost_data + lost_parity == 1;
+            }
+
+            plain += plain_ok;
+            protected_ += parity_ok;
+        }
+
+        unsigned parity_frames = (frames + group - 1) / group;
+        printf("%4.1f%%  %5u  %7.1f%%  %14.2f%%  %20.2f%%\n", loss / 10.0, group,
+               100.0 * parity_frames / frames, 100.0 * plain / transfers,
+               100.0 * protected_ / transfers);
+    }
+
+    return 0;
+}
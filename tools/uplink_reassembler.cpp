@@ -0,0 +1,248 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host side reassembler for the fragmented uplinks sent by the application
+ * on UPLINK_FRAGMENT_PORT.
+ *
+ * Reads one frame per line from stdin, as the hex encoded FRMPayload
+ * forwarded by the network server (spaces between bytes are allowed),
+ * and prints every transfer once all its frames arrived. A frame lost in a
+ * group protected by a parity frame is rebuilt from the others. Transfers
+ * still incomplete at the end of the input are listed with their missing
+ * frames. Backfilled readings ("HB") are decoded to one time and reading
+ * per line.
+ *
+ * Build with:
+ *     g++ -std=c++11 -I. tools/uplink_reassembler.cpp uplink_fec.cpp timestamp_codec.cpp \
+ *         sample_codec.cpp -o uplink_reassembler
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "uplink_frame.h"
+#include "uplink_fec.h"
+#include "timestamp_codec.h"
+#include "sample_codec.h"
+
+struct Transfer {
+    uint16_t last;
+    std::map<uint16_t, std::vector<uint8_t> > frames;
+    std::map<uint16_t, std::vector<uint8_t> > parity;
+    unsigned recovered = 0;
+    bool done = false;
+};
+
+/**
+ * Rebuilds the data frame missing from a group from its parity frame,
+ * if it is the only one missing
+ */
+static void recover(Transfer &transfer, uint16_t group)
+{
+    const std::vector<uint8_t> &parity = transfer.parity[group];
+    if (parity.size() < UPLINK_FEC_PARITY_OVERHEAD || parity[0] == 0) {
+        return;
+    }
+
+    uint8_t k = parity[0];
+    unsigned first = group * k;
+    unsigned end = first + k < (unsigned) transfer.last + 1 ? first + k : transfer.last + 1;
+    int missing = -1;
+    for (unsigned i = first; i < end; i++) {
+        if (!transfer.frames.count(i)) {
+            if (missing >= 0) {
+                return;
+            }
+            missing = i;
+        }
+    }
+    if (missing < 0) {
+        return;
+    }
+
+    uint8_t len = parity[1];
+    std::vector<uint8_t> data(parity.begin() + UPLINK_FEC_PARITY_OVERHEAD, parity.end());
+    for (unsigned i = first; i < end; i++) {
+        if ((int) i != missing) {
+            const std::vector<uint8_t> &frame = transfer.frames[i];
+            len ^= frame.size();
+            uplink_fec_xor(data.data(), frame.data(), frame.size());
+        }
+    }
+    if (len > data.size()) {
+        return;
+    }
+
+    data.resize(len);
+    transfer.frames[missing] = data;
+    transfer.recovered++;
+}
+
+static bool parse_hex(const std::string &line, std::vector<uint8_t> &bytes)
+{
+    std::string digits;
+    for (char c : line) {
+        if (isxdigit((unsigned char) c)) {
+            digits += c;
+        } else if (!isspace((unsigned char) c)) {
+            return false;
+        }
+    }
+    if (digits.size() % 2) {
+        return false;
+    }
+
+    bytes.clear();
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        bytes.push_back(std::stoi(digits.substr(i, 2), nullptr, 16));
+    }
+    return true;
+}
+
+/**
+ * Prints the backfilled readings: "HB" | flags | times length | times | readings
+ */
+static bool print_backfill(const std::vector<uint8_t> &payload)
+{
+    if (payload.size() < 5 || payload[0] != 'H' || payload[1] != 'B') {
+        return false;
+    }
+
+    size_t times_len = payload[3] << 8 | payload[4];
+    if (5 + times_len > payload.size()) {
+        return false;
+    }
+
+    TimestampDecoder times;
+    SampleDecoder values;
+    times.begin(payload.data() + 5, times_len);
+    values.begin(payload.data() + 5 + times_len, payload.size() - 5 - times_len);
+
+    printf("backfilled readings, times in %s\n",
+           payload[2] & 1 ? "GPS seconds" : "seconds from boot");
+    uint32_t time;
+    int32_t value;
+    while (times.next(time) && values.next(value)) {
+        printf("%lu %ld\n", (unsigned long) time, (long) value);
+    }
+    return true;
+}
+
+static void print_payload(uint8_t id, const Transfer &transfer)
+{
+    std::vector<uint8_t> payload;
+    for (const auto &frame : transfer.frames) {
+        payload.insert(payload.end(), frame.second.begin(), frame.second.end());
+    }
+
+    bool text = true;
+    for (uint8_t byte : payload) {
+        if (!isprint(byte) && !isspace(byte)) {
+            text = false;
+        }
+    }
+
+    printf("transfer %u: %zu bytes, %u frames rebuilt from parity\n",
+           id, payload.size(), transfer.recovered);
+    if (print_backfill(payload)) {
+        return;
+    }
+    if (text) {
+        printf("%.*s\n", (int) payload.size(), (const char *) payload.data());
+        return;
+    }
+    for (size_t i = 0; i < payload.size(); i++) {
+        printf("%02x%c", payload[i], i % 16 == 15 ? '\n' : ' ');
+    }
+    printf("\n");
+}
+
+int main()
+{
+    std::map<uint8_t, Transfer> transfers;
+    std::string line;
+    unsigned line_number = 0;
+
+    while (std::getline(std::cin, line)) {
+        line_number++;
+        std::vector<uint8_t> frame;
+        if (!parse_hex(line, frame) || frame.size() <= UPLINK_FRAME_HEADER_SIZE) {
+            if (!line.empty()) {
+                fprintf(stderr, "line %u: not a frame\n", line_number);
+            }
+            continue;
+        }
+
+        uplink_frame_header_t header;
+        uplink_frame_decode(frame.data(), header);
+
+        // a new transfer reusing the id starts over
+        auto it = transfers.find(header.transfer);
+        if (it != transfers.end() && it->second.last != header.last) {
+            transfers.erase(it);
+        }
+
+        Transfer &transfer = transfers[header.transfer];
+        transfer.last = header.last;
+        if (transfer.done) {
+            // parity of a group already complete
+            continue;
+        }
+        std::vector<uint8_t> payload(frame.begin() + UPLINK_FRAME_HEADER_SIZE, frame.end());
+
+        if (header.index > header.last) {
+            uint16_t group = header.index - header.last - 1;
+            transfer.parity[group] = payload;
+            recover(transfer, group);
+        } else {
+            transfer.frames[header.index] = payload;
+            for (const auto &parity : transfer.parity) {
+                if (parity.second.size() && parity.second[0]
+                        && parity.first == header.index / parity.second[0]) {
+                    recover(transfer, parity.first);
+                }
+            }
+        }
+
+        if (transfer.frames.size() == (size_t) header.last + 1) {
+            print_payload(header.transfer, transfer);
+            transfer.done = true;
+        }
+    }
+
+    for (const auto &entry : transfers) {
+        const Transfer &transfer = entry.second;
+        if (transfer.done) {
+            continue;
+        }
+        printf("transfer %u incomplete: %zu of %u frames, missing",
+               entry.first, transfer.frames.size(), transfer.last + 1);
+        for (uint16_t i = 0; i <= transfer.last; i++) {
+            if (!transfer.frames.count(i)) {
+                printf(" %u", i);
+            }
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
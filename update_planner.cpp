@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "update_planner.h"
+
+/**
+ * PHY payload of an empty uplink: MHDR, FHDR without options and MIC
+ */
+#define EMPTY_UPLINK_PHY_SIZE           12
+
+/**
+ * PHY payload of the ClassCSwitch/ClassAInit notifications with FPort
+ */
+#define CLASS_SWITCH_PHY_SIZE           25
+
+#define LORA_BANDWIDTH                  125000
+#define LORA_PREAMBLE_SYMBOLS           8
+#define LORA_CODING_RATE                1
+
+uint32_t lora_time_on_air(uint8_t datarate, uint8_t phy_payload_len)
+{
+    // DR6 (SF7/250 kHz) and DR7 (FSK) are costed as DR5
+    uint8_t sf = datarate > 5 ? 7 : 12 - datarate;
+    // low data rate optimization is mandated for SF11 and SF12 at 125 kHz
+    uint8_t de = sf >= 11 ? 1 : 0;
+    uint32_t symbol_us = (1UL << sf) * (1000000UL / LORA_BANDWIDTH);
+
+    int32_t num = 8 * phy_payload_len - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * de);
+    int32_t payload_symbols = 8;
+    if (num > 0) {
+        payload_symbols += ((num + den - 1) / den) * (LORA_CODING_RATE + 4);
+    }
+
+    // the preamble is followed by 4.25 sync symbols
+    uint32_t air_us = (LORA_PREAMBLE_SYMBOLS * 4 + 17) * symbol_us / 4
+                      + payload_symbols * symbol_us;
+
+    return (air_us + 999) / 1000;
+}
+
+bool update_prefers_class_a_polling(uint16_t fragments, uint8_t datarate)
+{
+    if (fragments == 0) {
+        return true;
+    }
+
+    uint32_t poll_air = lora_time_on_air(datarate, EMPTY_UPLINK_PHY_SIZE);
+    uint64_t poll_duration = (uint64_t) fragments * poll_air * 1000 / UPDATE_POLL_DUTY_CYCLE;
+    if (poll_duration > UPDATE_MAX_POLL_DURATION) {
+        return false;
+    }
+
+    // Receiving the fragments costs the same in both classes, so only the
+    // extra radio time is compared: one uplink per fragment for polling,
+    // continuous reception plus the two class switch notifications for C.
+    uint64_t poll_charge = (uint64_t) fragments * poll_air * UPDATE_TX_CURRENT_UA;
+    uint64_t class_c_charge = (uint64_t) fragments * UPDATE_CLASS_C_FRAGMENT_INTERVAL
+                              * UPDATE_RX_CURRENT_UA
+                              + 2ULL * lora_time_on_air(datarate, CLASS_SWITCH_PHY_SIZE)
+                              * UPDATE_TX_CURRENT_UA;
+
+    return poll_charge < class_c_charge;
+}
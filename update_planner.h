@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPDATE_PLANNER_H_
+#define APP_UPDATE_PLANNER_H_
+
+#include <cstdint>
+
+/*
+ * Energy model used to decide how an announced update is received.
+ *
+ * Currents are typical SX127x figures at 3.3 V and can be overridden per
+ * target with macros in mbed_app.json.
+ */
+
+/**
+ * Radio current while transmitting at 14 dBm, in uA
+ */
+#ifndef UPDATE_TX_CURRENT_UA
+#define UPDATE_TX_CURRENT_UA            29000
+#endif
+
+/**
+ * Radio current while receiving, in uA
+ */
+#ifndef UPDATE_RX_CURRENT_UA
+#define UPDATE_RX_CURRENT_UA            11000
+#endif
+
+/**
+ * Interval at which the server sends fragments to a class C device, in ms
+ */
+#ifndef UPDATE_CLASS_C_FRAGMENT_INTERVAL
+#define UPDATE_CLASS_C_FRAGMENT_INTERVAL 2000
+#endif
+
+/**
+ * Longest update we accept to pull with class A polling, in ms.
+ * Beyond this class C is used regardless of energy.
+ */
+#ifndef UPDATE_MAX_POLL_DURATION
+#define UPDATE_MAX_POLL_DURATION        (10 * 60 * 1000)
+#endif
+
+/**
+ * Duty cycle the poll uplinks are limited to, in 1/1000
+ */
+#ifndef UPDATE_POLL_DUTY_CYCLE
+#define UPDATE_POLL_DUTY_CYCLE          10
+#endif
+
+/**
+ * Returns the time on air in ms of a LoRa frame carrying phy_payload_len
+ * bytes at the given EU868 data rate (DR0 = SF12 ... DR5 = SF7, 125 kHz).
+ */
+uint32_t lora_time_on_air(uint8_t datarate, uint8_t phy_payload_len);
+
+/**
+ * Returns true if receiving an update of the given number of fragments is
+ * cheaper with empty class A uplinks than by switching to class C, and the
+ * polling fits within UPDATE_MAX_POLL_DURATION at the duty-cycle rate.
+ */
+bool update_prefers_class_a_polling(uint16_t fragments, uint8_t datarate);
+
+#endif /* APP_UPDATE_PLANNER_H_ */
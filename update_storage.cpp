@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "update_storage.h"
+
+UpdateStorage::UpdateStorage(BlockDevice *bd, bd_size_t reserved)
+    : _bd(bd),
+      _reserved(reserved),
+      _initialized(false),
+      _image_size(0),
+      _erased_until(0),
+      _erase_stalls(0)
+{
+}
+
+int UpdateStorage::begin(bd_size_t image_size)
+{
+    _image_size = 0;
+    _erased_until = 0;
+    _erase_stalls = 0;
+
+    if (_bd == NULL) {
+        printf("\r\n No block device to stage the update \r\n");
+        return -1;
+    }
+
+    if (!_initialized) {
+        int err = _bd->init();
+        if (err) {
+            printf("\r\n Staging block device init failed: %d \r\n", err);
+            return err;
+        }
+        _initialized = true;
+    }
+
+    if (_reserved > _bd->size() || image_size > _bd->size() - _reserved
+            || UPDATE_FRAGMENT_SIZE % _bd->get_program_size()) {
+        printf("\r\n Update does not fit the staging block device \r\n");
+        return -1;
+    }
+
+    _image_size = image_size;
+    return 0;
+}
+
+bool UpdateStorage::erase_step()
+{
+    if (_erased_until >= _image_size) {
+        return false;
+    }
+
+    if (erase_next_sector()) {
+        return false;
+    }
+
+    return _erased_until < _image_size;
+}
+
+int UpdateStorage::program(bd_addr_t offset, const uint8_t *data, bd_size_t size)
+{
+    if (offset + size > _image_size) {
+        return -1;
+    }
+
+    if (_erased_until < offset + size) {
+        _erase_stalls++;
+        while (_erased_until < offset + size) {
+            int err = erase_next_sector();
+            if (err) {
+                return err;
+            }
+        }
+    }
+
+    bd_size_t program_size = _bd->get_program_size();
+    bd_size_t aligned = size - size % program_size;
+    int err = 0;
+    if (aligned) {
+        err = _bd->program(data, offset, aligned);
+    }
+
+    // pad the tail of a short last fragment with the erased value
+    if (err == 0 && aligned < size) {
+        uint8_t tail[UPDATE_FRAGMENT_SIZE];
+        int erase_value = _bd->get_erase_value();
+        memset(tail, erase_value < 0 ? 0xFF : erase_value, program_size);
+        memcpy(tail, data + aligned, size - aligned);
+        err = _bd->program(tail, offset + aligned, program_size);
+    }
+
+    return err;
+}
+
+int UpdateStorage::erase_next_sector()
+{
+    bd_size_t sector = _bd->get_erase_size(_erased_until);
+    int err = _bd->erase(_erased_until, sector);
+    if (err) {
+        printf("\r\n Staging erase failed at 0x%lx: %d \r\n",
+               (unsigned long) _erased_until, err);
+        return err;
+    }
+    _erased_until += sector;
+    return 0;
+}
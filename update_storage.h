@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPDATE_STORAGE_H_
+#define APP_UPDATE_STORAGE_H_
+
+#include <cstdint>
+#include "blockdevice/BlockDevice.h"
+
+/**
+ * Bytes of image data carried by each UpdateData fragment.
+ * Must be a multiple of the staging block device program size.
+ */
+#ifndef UPDATE_FRAGMENT_SIZE
+#define UPDATE_FRAGMENT_SIZE            32
+#endif
+
+/**
+ * Delay between two background erase steps, in ms. Each step erases one
+ * sector; the delay leaves room for RX events queued in the meantime.
+ */
+#ifndef UPDATE_ERASE_STEP_INTERVAL
+#define UPDATE_ERASE_STEP_INTERVAL      50
+#endif
+
+/**
+ * When set, updates are staged in RAM behind a SlowBlockDevice that
+ * mimics internal flash timings instead of the default block device.
+ */
+#ifndef UPDATE_STORAGE_SIMULATE_SLOW_FLASH
+#define UPDATE_STORAGE_SIMULATE_SLOW_FLASH 0
+#endif
+
+/**
+ * Geometry and timings of the simulated flash: 2 KB sectors erased in
+ * 30 ms and 8 byte words programmed in 60 us, in the range of STM32L0/L1
+ * pages and the small F4 sectors. Large enough for 255 fragments.
+ */
+#define UPDATE_SIMULATED_FLASH_SIZE     8192
+#define UPDATE_SIMULATED_SECTOR_SIZE    2048
+#define UPDATE_SIMULATED_PROGRAM_SIZE   8
+#define UPDATE_SIMULATED_ERASE_TIME     30
+#define UPDATE_SIMULATED_PROGRAM_TIME   60
+
+/*
+ * Staging area for a received update.
+ *
+ * Sectors are erased ahead of the fragments with erase_step(), called from
+ * the event queue between fragments, so writing a fragment normally only
+ * programs. A fragment landing on a sector that is not erased yet erases
+ * it first and is counted as a stall.
+ */
+class UpdateStorage {
+public:
+    /**
+     * @param bd        Block device holding the staging area
+     * @param reserved  Bytes at the end of the block device kept for
+     *                  other uses, such as the history log
+     */
+    UpdateStorage(BlockDevice *bd, bd_size_t reserved = 0);
+
+    /**
+     * Prepares the staging area for an image of the given size.
+     * Returns 0 on success, a negative value if there is no usable storage.
+     */
+    int begin(bd_size_t image_size);
+
+    /**
+     * Erases the next sector of the staging area.
+     * Returns true while more sectors remain to be erased.
+     */
+    bool erase_step();
+
+    /**
+     * Writes image data at the given offset, erasing first if needed.
+     */
+    int program(bd_addr_t offset, const uint8_t *data, bd_size_t size);
+
+    /**
+     * Number of writes that had to wait for an erase since begin()
+     */
+    uint32_t erase_stalls() const
+    {
+        return _erase_stalls;
+    };
+
+private:
+    int erase_next_sector();
+
+    BlockDevice *_bd;
+    bd_size_t _reserved;
+    bool _initialized;
+    bd_size_t _image_size;
+    bd_addr_t _erased_until;
+    uint32_t _erase_stalls;
+};
+
+#endif /* APP_UPDATE_STORAGE_H_ */
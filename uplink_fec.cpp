@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uplink_fec.h"
+
+uint8_t uplink_fec_group_size(uint16_t loss_permille)
+{
+    if (loss_permille == 0) {
+        return 0;
+    }
+
+    float p = loss_permille / 1000.0f;
+    uint8_t group = 2;
+
+    for (uint8_t k = 2; k <= UPLINK_FEC_MAX_GROUP; k++) {
+        // a group of k data frames and its parity survives one loss
+        uint8_t n = k + 1;
+        float none = 1.0f;
+        for (uint8_t i = 0; i < n - 1; i++) {
+            none *= 1.0f - p;
+        }
+        float survives = none * (1.0f - p) + n * p * none;
+        if ((1.0f - survives) * 1000.0f > UPLINK_FEC_TARGET_GROUP_LOSS) {
+            break;
+        }
+        group = k;
+    }
+
+    return group;
+}
+
+void uplink_fec_xor(uint8_t *parity, const uint8_t *data, uint8_t len)
+{
+    while (len--) {
+        *parity++ ^= *data++;
+    }
+}
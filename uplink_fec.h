@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPLINK_FEC_H_
+#define APP_UPLINK_FEC_H_
+
+#include <cstdint>
+
+/*
+ * Parity frames for fragmented uplinks.
+ *
+ * Data frames are sent in groups of k, each followed by a parity frame
+ * holding the XOR of their payloads, so the server can rebuild any one
+ * frame lost in a group without asking for it again. A parity frame has
+ * the index last + 1 + group in its uplink_frame_header_t and carries:
+ *     k | XOR of the payload lengths | XOR of the payloads (zero padded)
+ *
+ * Shared with the host tools, so it only depends on the C++ standard
+ * library.
+ */
+
+/**
+ * Bytes a parity frame adds in front of the XOR of the payloads
+ */
+#define UPLINK_FEC_PARITY_OVERHEAD      2
+
+/**
+ * Largest group of data frames protected by one parity frame
+ */
+#define UPLINK_FEC_MAX_GROUP            16
+
+/**
+ * Chance of losing a group, i.e. two of its frames, that the group size
+ * is chosen to stay under, in 1/1000
+ */
+#ifndef UPLINK_FEC_TARGET_GROUP_LOSS
+#define UPLINK_FEC_TARGET_GROUP_LOSS    10
+#endif
+
+/**
+ * Number of data frames per parity frame for the given frame loss rate
+ * in 1/1000: the largest group whose loss stays under
+ * UPLINK_FEC_TARGET_GROUP_LOSS, at least 2. Returns 0, no parity, when
+ * no frames are lost.
+ */
+uint8_t uplink_fec_group_size(uint16_t loss_permille);
+
+/**
+ * XORs len bytes of data into parity
+ */
+void uplink_fec_xor(uint8_t *parity, const uint8_t *data, uint8_t len);
+
+#endif /* APP_UPLINK_FEC_H_ */
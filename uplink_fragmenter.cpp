@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "uplink_fragmenter.h"
+#include "update_planner.h"
+
+UplinkFragmenter::UplinkFragmenter()
+    : _data(0),
+      _size(0),
+      _chunk(0),
+      _transfer(0),
+      _next(0),
+      _count(0),
+      _group(0),
+      _parity_built(0)
+{
+}
+
+int UplinkFragmenter::start(const uint8_t *data, uint32_t size, uint8_t frame_size,
+                            uint8_t parity_group)
+{
+    uint8_t overhead = UPLINK_FRAME_HEADER_SIZE + (parity_group ? UPLINK_FEC_PARITY_OVERHEAD : 0);
+    if (busy() || size == 0 || frame_size <= overhead) {
+        return -1;
+    }
+
+    uint8_t chunk = frame_size - overhead;
+    uint32_t count = (size + chunk - 1) / chunk;
+    uint32_t parity = parity_group ? (count + parity_group - 1) / parity_group : 0;
+    if (count + parity > UPLINK_FRAME_MAX_COUNT) {
+        return -1;
+    }
+
+    _data = data;
+    _size = size;
+    _chunk = chunk;
+    _count = count;
+    _group = parity_group;
+    _next = 0;
+    _parity_built = 0;
+    _parity_timer.reset();
+    _transfer++;
+    return _transfer;
+}
+
+uint8_t UplinkFragmenter::next_frame(uint8_t *frame) const
+{
+    if (!busy() || _next >= frame_count()) {
+        return 0;
+    }
+
+    // each group of data frames is followed by its parity frame
+    uint16_t index = _next;
+    if (_group) {
+        uint16_t group = _next / (_group + 1);
+        uint16_t member = _next % (_group + 1);
+        index = group * _group + member;
+        if (member == _group || index >= _count) {
+            return build_parity(group, frame);
+        }
+    }
+
+    uplink_frame_header_t header = { _transfer, index, (uint16_t)(_count - 1) };
+    uplink_frame_encode(header, frame);
+
+    uint32_t offset = (uint32_t) index * _chunk;
+    uint8_t len = _size - offset < _chunk ? _size - offset : _chunk;
+    memcpy(frame + UPLINK_FRAME_HEADER_SIZE, _data + offset, len);
+    return UPLINK_FRAME_HEADER_SIZE + len;
+}
+
+uint8_t UplinkFragmenter::build_parity(uint16_t group, uint8_t *frame) const
+{
+    _parity_timer.start();
+
+    uplink_frame_header_t header = { _transfer, (uint16_t)(_count + group), (uint16_t)(_count - 1) };
+    uplink_frame_encode(header, frame);
+
+    uint8_t *parity = frame + UPLINK_FRAME_HEADER_SIZE;
+    parity[0] = _group;
+    parity[1] = 0;
+    memset(parity + UPLINK_FEC_PARITY_OVERHEAD, 0, _chunk);
+
+    uint16_t end = (group + 1) * _group < _count ? (group + 1) * _group : _count;
+    for (uint16_t index = group * _group; index < end; index++) {
+        uint32_t offset = (uint32_t) index * _chunk;
+        uint8_t len = _size - offset < _chunk ? _size - offset : _chunk;
+        parity[1] ^= len;
+        uplink_fec_xor(parity + UPLINK_FEC_PARITY_OVERHEAD, _data + offset, len);
+    }
+
+    _parity_timer.stop();
+    _parity_built++;
+    return UPLINK_FRAME_HEADER_SIZE + UPLINK_FEC_PARITY_OVERHEAD + _chunk;
+}
+
+void UplinkFragmenter::frame_sent()
+{
+    if (!busy()) {
+        return;
+    }
+
+    _next++;
+    if (_next >= frame_count()) {
+        cancel();
+    }
+}
+
+void UplinkFragmenter::resume(uint8_t transfer, uint16_t index)
+{
+    if (busy() && transfer == _transfer && index < _count) {
+        _next = _group ? index / _group * (_group + 1) + index % _group : index;
+    }
+}
+
+void UplinkFragmenter::cancel()
+{
+    _data = 0;
+    _size = 0;
+}
+
+uint32_t UplinkFragmenter::pacing_delay(uint8_t datarate, uint8_t frame_len)
+{
+    uint32_t air = lora_time_on_air(datarate, frame_len + UPLINK_FRAME_PHY_OVERHEAD);
+    return air * 1000 / UPLINK_FRAGMENT_DUTY_CYCLE - air;
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPLINK_FRAGMENTER_H_
+#define APP_UPLINK_FRAGMENTER_H_
+
+#include <cstdint>
+#include "drivers/Timer.h"
+#include "uplink_frame.h"
+#include "uplink_fec.h"
+
+/**
+ * Share of the airtime fragmented uplinks may use, in 1/1000. Kept below
+ * the 1% of the EU868 sub-bands so regular messages still get through.
+ */
+#ifndef UPLINK_FRAGMENT_DUTY_CYCLE
+#define UPLINK_FRAGMENT_DUTY_CYCLE      5
+#endif
+
+/**
+ * PHY payload added to a frame by LoRaWAN: MHDR, FHDR, FPort and MIC
+ */
+#define UPLINK_FRAME_PHY_OVERHEAD       13
+
+/*
+ * Splits a payload larger than one uplink into frames with a
+ * uplink_frame_header_t. The payload stays in the caller's buffer until
+ * the transfer is done. A frame only counts as sent once frame_sent() is
+ * called on TX_DONE, so after a TX error or a rejoin the same frame is
+ * built again and the transfer resumes where it stopped.
+ *
+ * With a parity group size, a parity frame (see uplink_fec.h) follows
+ * every group of data frames. Data frames then carry
+ * UPLINK_FEC_PARITY_OVERHEAD bytes less so parity frames fit frame_size.
+ */
+class UplinkFragmenter {
+public:
+    UplinkFragmenter();
+
+    /**
+     * Starts sending size bytes of data in frames of at most frame_size
+     * bytes, header included, with a parity frame after every group of
+     * parity_group data frames (0 for none).
+     * Returns the transfer id, or -1 if a transfer is already running or
+     * the payload needs more than UPLINK_FRAME_MAX_COUNT frames.
+     */
+    int start(const uint8_t *data, uint32_t size, uint8_t frame_size,
+              uint8_t parity_group = 0);
+
+    /**
+     * Builds the next frame to send into frame.
+     * Returns its length, 0 if the transfer is complete.
+     */
+    uint8_t next_frame(uint8_t *frame) const;
+
+    /**
+     * Moves on to the next frame once the last one was transmitted
+     */
+    void frame_sent();
+
+    /**
+     * Continues the transfer from the given data frame, e.g. when the
+     * server lost frames after an interruption
+     */
+    void resume(uint8_t transfer, uint16_t index);
+
+    void cancel();
+
+    bool busy() const
+    {
+        return _data != 0;
+    };
+
+    uint8_t transfer() const
+    {
+        return _transfer;
+    };
+
+    /**
+     * Position of the next frame in the transfer, parity frames included
+     */
+    uint16_t next_index() const
+    {
+        return _next;
+    };
+
+    /**
+     * Number of frames in the transfer, parity frames included
+     */
+    uint16_t frame_count() const
+    {
+        return _count + parity_count();
+    };
+
+    uint8_t parity_group() const
+    {
+        return _group;
+    };
+
+    /**
+     * Parity frames built so far and the time spent building them, in us
+     */
+    uint32_t parity_built() const
+    {
+        return _parity_built;
+    };
+
+    uint32_t parity_time() const
+    {
+        return _parity_timer.elapsed_time().count();
+    };
+
+    /**
+     * Delay to wait after sending a frame of frame_len bytes at the given
+     * data rate to stay within UPLINK_FRAGMENT_DUTY_CYCLE, in ms
+     */
+    static uint32_t pacing_delay(uint8_t datarate, uint8_t frame_len);
+
+private:
+    uint16_t parity_count() const
+    {
+        return _group ? (_count + _group - 1) / _group : 0;
+    };
+
+    uint8_t build_parity(uint16_t group, uint8_t *frame) const;
+
+    const uint8_t *_data;
+    uint32_t _size;
+    uint8_t _chunk;
+    uint8_t _transfer;
+    uint16_t _next;
+    uint16_t _count;
+    uint8_t _group;
+    mutable uint32_t _parity_built;
+    mutable mbed::Timer _parity_timer;
+};
+
+#endif /* APP_UPLINK_FRAGMENTER_H_ */
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPLINK_FRAME_H_
+#define APP_UPLINK_FRAME_H_
+
+#include <cstdint>
+
+/*
+ * Header of the frames of a fragmented uplink, shared by the device and
+ * the host side reassembler (tools/uplink_reassembler.cpp), so it only
+ * depends on the C++ standard library.
+ *
+ * Each frame starts with 4 bytes:
+ *     transfer id (8 bit) | frame index (12 bit) | last index (12 bit)
+ * followed by the payload bytes of that frame. Every frame but the last
+ * carries the same number of payload bytes.
+ */
+
+#define UPLINK_FRAME_HEADER_SIZE        4
+
+/**
+ * Most frames a transfer can be split into
+ */
+#define UPLINK_FRAME_MAX_COUNT          4096
+
+typedef struct {
+    uint8_t transfer;
+    uint16_t index;
+    uint16_t last;
+} uplink_frame_header_t;
+
+inline void uplink_frame_encode(const uplink_frame_header_t &header, uint8_t *frame)
+{
+    frame[0] = header.transfer;
+    frame[1] = header.index >> 4;
+    frame[2] = (header.index << 4) | ((header.last >> 8) & 0x0F);
+    frame[3] = header.last;
+}
+
+inline void uplink_frame_decode(const uint8_t *frame, uplink_frame_header_t &header)
+{
+    header.transfer = frame[0];
+    header.index = (frame[1] << 4) | (frame[2] >> 4);
+    header.last = ((frame[2] & 0x0F) << 8) | frame[3];
+}
+
+#endif /* APP_UPLINK_FRAME_H_ */
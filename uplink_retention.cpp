@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "uplink_retention.h"
+
+UplinkRetention::UplinkRetention()
+    : _next_seq(0),
+      _next_slot(0),
+      _retransmitted(0),
+      _dropped(0)
+{
+    memset(_records, 0, sizeof(_records));
+}
+
+uint8_t UplinkRetention::add(const uint8_t *data, uint8_t len, uint8_t *frame)
+{
+    if (len > UPLINK_RETENTION_RECORD_SIZE) {
+        return 0;
+    }
+
+    // slots are reused in sequence order, so the next one is the oldest
+    record_t &record = _records[_next_slot];
+    if (record.used) {
+        _dropped++;
+    }
+    _next_slot = (_next_slot + 1) % UPLINK_RETENTION_SLOTS;
+
+    record.used = 1;
+    record.missing = 0;
+    record.seq = _next_seq++;
+    record.len = len;
+    memcpy(record.data, data, len);
+    return build_frame(record, frame);
+}
+
+void UplinkRetention::ack(uint16_t base, uint32_t bitmap, uint16_t &received, uint16_t &missing)
+{
+    received = 0;
+    missing = 0;
+    if (bitmap == 0) {
+        return;
+    }
+
+    // only records older than the newest one received can be missing
+    uint8_t newest = 31;
+    while (!(bitmap & (1UL << newest))) {
+        newest--;
+    }
+
+    for (uint8_t i = 0; i < UPLINK_RETENTION_SLOTS; i++) {
+        record_t &record = _records[i];
+        if (!record.used) {
+            continue;
+        }
+
+        int16_t offset = record.seq - base;
+        if (offset < 0 || (offset < UPLINK_RETENTION_ACK_WINDOW && (bitmap & (1UL << offset)))) {
+            record.used = 0;
+            received++;
+        } else if (offset < newest) {
+            record.missing = 1;
+            missing++;
+        }
+    }
+}
+
+uint8_t UplinkRetention::next_gap(uint8_t *frame)
+{
+    record_t *oldest = NULL;
+    for (uint8_t i = 0; i < UPLINK_RETENTION_SLOTS; i++) {
+        record_t &record = _records[i];
+        if (record.used && record.missing
+                && (oldest == NULL || (int16_t)(record.seq - oldest->seq) < 0)) {
+            oldest = &record;
+        }
+    }
+
+    if (oldest == NULL) {
+        return 0;
+    }
+
+    oldest->missing = 0;
+    _retransmitted++;
+    return build_frame(*oldest, frame);
+}
+
+uint8_t UplinkRetention::resend_oldest(uint8_t *frame)
+{
+    record_t &record = _records[_next_slot];
+    if (!record.used) {
+        return 0;
+    }
+
+    record.missing = 0;
+    _retransmitted++;
+    return build_frame(record, frame);
+}
+
+uint8_t UplinkRetention::retained() const
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < UPLINK_RETENTION_SLOTS; i++) {
+        count += _records[i].used;
+    }
+    return count;
+}
+
+uint8_t UplinkRetention::build_frame(const record_t &record, uint8_t *frame) const
+{
+    frame[0] = record.seq >> 8;
+    frame[1] = record.seq;
+    memcpy(frame + UPLINK_RETENTION_HEADER_SIZE, record.data, record.len);
+    return UPLINK_RETENTION_HEADER_SIZE + record.len;
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2017, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APP_UPLINK_RETENTION_H_
+#define APP_UPLINK_RETENTION_H_
+
+#include <cstdint>
+
+/**
+ * Telemetry records kept until the server acknowledges them
+ */
+#ifndef UPLINK_RETENTION_SLOTS
+#define UPLINK_RETENTION_SLOTS          16
+#endif
+
+/**
+ * Bytes of the sequence number in front of each record
+ */
+#define UPLINK_RETENTION_HEADER_SIZE    2
+
+/**
+ * Largest record, so header and record fit the 30 byte tx_buffer
+ */
+#define UPLINK_RETENTION_RECORD_SIZE    (30 - UPLINK_RETENTION_HEADER_SIZE)
+
+/**
+ * Sequence numbers covered by one acknowledgement bitmap
+ */
+#define UPLINK_RETENTION_ACK_WINDOW     32
+
+/*
+ * Keeps unconfirmed telemetry uplinks, numbered with a 16 bit sequence
+ * number, until the server acknowledges them with a bitmap covering
+ * UPLINK_RETENTION_ACK_WINDOW sequence numbers. Records missing from the
+ * bitmap, below the newest one received, are handed out again for
+ * retransmission; the others wait for the next bitmap. While full(), the
+ * caller holds new records and sends the oldest one again instead, which
+ * the server answers with a bitmap.
+ *
+ * One downlink thus acknowledges up to 32 uplinks, instead of one per
+ * uplink for confirmed messages.
+ */
+class UplinkRetention {
+public:
+    UplinkRetention();
+
+    /**
+     * Retains a record of at most UPLINK_RETENTION_RECORD_SIZE bytes and
+     * builds its frame, <sequence number (16 bit BE)><record>.
+     * The oldest record is dropped if every slot is in use.
+     * Returns the frame length, 0 if the record is too long.
+     */
+    uint8_t add(const uint8_t *data, uint8_t len, uint8_t *frame);
+
+    /**
+     * Applies an acknowledgement: bit i of bitmap set means sequence
+     * number base + i was received. Records before base count as
+     * received. Sets received and missing to the number of retained
+     * records found in each state.
+     */
+    void ack(uint16_t base, uint32_t bitmap, uint16_t &received, uint16_t &missing);
+
+    /**
+     * Builds the frame of the oldest record reported missing, which is
+     * then not handed out again until the next acknowledgement.
+     * Returns the frame length, 0 if nothing is missing.
+     */
+    uint8_t next_gap(uint8_t *frame);
+
+    /**
+     * Set when the next add() would drop a record not acknowledged yet
+     */
+    bool full() const
+    {
+        return _records[_next_slot].used;
+    };
+
+    /**
+     * Builds the frame of the record the next add() would drop, sent
+     * again to ask for an acknowledgement while full().
+     * Returns the frame length, 0 if that slot is free.
+     */
+    uint8_t resend_oldest(uint8_t *frame);
+
+    uint8_t retained() const;
+
+    uint32_t retransmitted() const
+    {
+        return _retransmitted;
+    };
+
+    uint32_t dropped() const
+    {
+        return _dropped;
+    };
+
+private:
+    typedef struct {
+        uint8_t used;
+        uint8_t missing;
+        uint16_t seq;
+        uint8_t len;
+        uint8_t data[UPLINK_RETENTION_RECORD_SIZE];
+    } record_t;
+
+    uint8_t build_frame(const record_t &record, uint8_t *frame) const;
+
+    record_t _records[UPLINK_RETENTION_SLOTS];
+    uint16_t _next_seq;
+    uint8_t _next_slot;
+    uint32_t _retransmitted;
+    uint32_t _dropped;
+};
+
+#endif /* APP_UPLINK_RETENTION_H_ */